@@ -10,32 +10,45 @@
   
 /* See [8254] for hardware details of the 8254 timer chip. */
 
-#if TIMER_FREQ < 19
-#error 8254 timer requires TIMER_FREQ >= 19
-#endif
-#if TIMER_FREQ > 1000
-#error TIMER_FREQ <= 1000 recommended
-#endif
+/* Number of timer interrupts per second.  May be changed with the
+   "-tf" kernel command-line option before timer_init() runs. */
+int timer_freq = TIMER_FREQ_DEFAULT;
 
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* PIT cycles per timer tick, and the most ticks that fit in the
+   PIT's 16-bit counter. */
+#define TICK_COUNT ((PIT_HZ + timer_freq / 2) / timer_freq)
+#define MAX_STRETCH (65535 / TICK_COUNT)
+
+/* While the timer is programmed to fire once instead of
+   periodically, the number of ticks that will then have passed
+   and the number of PIT cycles programmed; otherwise both 0.
+   The cycles reach to a tick boundary, but the first tick may be
+   one that was already under way. */
+static int stretch_ticks;
+static unsigned stretch_cycles;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
 
 static intr_handler_func timer_interrupt;
+static void stretch_one_shot (int n, unsigned cycles);
 static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 static void real_time_delay (int64_t num, int32_t denom);
 
-/* Sets up the timer to interrupt TIMER_FREQ times per second,
+/* Sets up the timer to interrupt timer_freq times per second,
    and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
-  pit_configure_channel (0, 2, TIMER_FREQ);
+  ASSERT (timer_freq >= TIMER_FREQ_MIN && timer_freq <= TIMER_FREQ_MAX);
+
+  pit_configure_channel (0, 2, timer_freq);
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
 }
 
@@ -63,7 +76,7 @@ timer_calibrate (void)
     if (!too_many_loops (loops_per_tick | test_bit))
       loops_per_tick |= test_bit;
 
-  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * TIMER_FREQ);
+  printf ("%'"PRIu64" loops/s.\n", (uint64_t) loops_per_tick * timer_freq);
 }
 
 /* Returns the number of timer ticks since the OS booted. */
@@ -176,11 +189,100 @@ timer_print_stats (void)
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
-  ticks++;
-  thread_tick ();
+  int n = 1;
+
+  if (stretch_ticks > 0)
+    {
+      /* The one-shot countdown ran out: account for every tick
+         it covered and resume periodic interrupts. */
+      n = stretch_ticks;
+      stretch_ticks = 0;
+      stretch_cycles = 0;
+      pit_configure_channel (0, 2, timer_freq);
+    }
+  while (n-- > 0)
+    {
+      ticks++;
+      thread_tick ();
+    }
   thread_wake(ticks);
 }
 
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  If no sleeping thread is due on the next tick, programs
+   the timer to interrupt once, as late as the next deadline and
+   the PIT's counter allow, instead of on every tick.  The
+   countdown includes what is left of the tick in progress. */
+void
+timer_idle_enter (void)
+{
+  unsigned left;
+  int n;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  /* A countdown is still running: one whose interrupt
+     timer_idle_exit() found pending, or the rest of the tick it
+     left in progress. */
+  if (stretch_ticks > 0)
+    return;
+
+  n = thread_next_wakeup (MAX_STRETCH) - ticks;
+  if (n <= 1)
+    return;
+  left = pit_read_count (0);
+  if (left == 0 || left > (unsigned) TICK_COUNT)
+    left = TICK_COUNT;
+  stretch_one_shot (n, left + (n - 1) * TICK_COUNT);
+}
+
+/* Called by the idle thread, with interrupts off, once it has
+   been woken.  If an interrupt other than the timer's woke it
+   before the countdown ran out, catches the tick count up with
+   the time that has passed.  The tick in progress is finished
+   by a one-shot countdown of the cycles it has left, whose
+   interrupt resumes periodic interrupts, so that no time is
+   lost. */
+void
+timer_idle_exit (void)
+{
+  unsigned left, ahead, passed;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (stretch_ticks == 0)
+    return;
+
+  /* A count of zero, or above what we programmed, means the
+     counter ran out, so the timer interrupt is pending and will
+     do the accounting itself as soon as we enable interrupts. */
+  left = pit_read_count (0);
+  if (left == 0 || left > stretch_cycles)
+    return;
+
+  /* Tick boundaries fall every TICK_COUNT cycles counting back
+     from the end of the countdown; those not yet reached include
+     the one that ends the tick in progress. */
+  ahead = DIV_ROUND_UP (left, TICK_COUNT);
+  passed = stretch_ticks - ahead;
+  ticks += passed;
+  thread_idle_ticks (passed);
+  stretch_one_shot (1, left - (ahead - 1) * TICK_COUNT);
+  thread_wake (ticks);
+}
+
+/* Programs the timer to interrupt once, after CYCLES PIT cycles,
+   at which point N more ticks will have passed. */
+static void
+stretch_one_shot (int n, unsigned cycles)
+{
+  ASSERT (n > 0 && cycles > 0 && cycles <= 65535);
+
+  stretch_ticks = n;
+  stretch_cycles = cycles;
+  pit_start_one_shot (0, cycles);
+}
+
 /* Returns true if LOOPS iterations waits for more than one timer
    tick, otherwise false. */
 static bool
@@ -221,10 +323,10 @@ real_time_sleep (int64_t num, int32_t denom)
   /* Convert NUM/DENOM seconds into timer ticks, rounding down.
           
         (NUM / DENOM) s          
-     ---------------------- = NUM * TIMER_FREQ / DENOM ticks. 
-     1 s / TIMER_FREQ ticks
+     ---------------------- = NUM * timer_freq / DENOM ticks. 
+     1 s / timer_freq ticks
   */
-  int64_t ticks = num * TIMER_FREQ / denom;
+  int64_t ticks = num * timer_freq / denom;
 
   ASSERT (intr_get_level () == INTR_ON);
   if (ticks > 0)
@@ -249,5 +351,5 @@ real_time_delay (int64_t num, int32_t denom)
   /* Scale the numerator and denominator down by 1000 to avoid
      the possibility of overflow. */
   ASSERT (denom % 1000 == 0);
-  busy_wait (loops_per_tick * num / 1000 * TIMER_FREQ / (denom / 1000)); 
+  busy_wait (loops_per_tick * num / 1000 * timer_freq / (denom / 1000)); 
 }
@@ -4,8 +4,15 @@
 #include <round.h>
 #include <stdint.h>
 
-/* Number of timer interrupts per second. */
-#define TIMER_FREQ 100
+/* Number of timer interrupts per second: the default, and the
+   range accepted by the "-tf" option.  The 8254 cannot go below
+   19 Hz, and much above 1000 Hz the kernel does little but
+   service the timer. */
+#define TIMER_FREQ_DEFAULT 100
+#define TIMER_FREQ_MIN 19
+#define TIMER_FREQ_MAX 1000
+
+extern int timer_freq;
 
 void timer_init (void);
 void timer_calibrate (void);
@@ -24,6 +31,10 @@ void timer_mdelay (int64_t milliseconds);
 void timer_udelay (int64_t microseconds);
 void timer_ndelay (int64_t nanoseconds);
 
+/* Tickless idle. */
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -37,6 +37,10 @@ main (int argc, char *argv[])
       return EXIT_FAILURE;
     }
 
+  /* Reserve the output file's space in one go.  This is only an
+     optimization, so failure is not fatal. */
+  fallocate (out_fd, filesize (in_fd));
+
   /* Copy data. */
   for (;;) 
     {
@@ -54,7 +54,7 @@ void cache_evict(void){
     
     for(;; e = clock_next(&cache_list,e)){
         struct cache_entry * temp = list_entry(e,struct cache_entry, elem);
-        if(temp->accessed){
+        if(temp->accessed && !temp->pinned){
             // printf("evict : %d\n",temp->block_idx);
             cache_write_back(temp);
             struct cache_entry * next = list_entry(clock_next(&cache_list,e),struct cache_entry, elem);
@@ -81,6 +81,7 @@ struct cache_entry * set_cache(struct block *block, block_sector_t sector){
     cache->accessed = false;
     cache->block_idx = sector;
     cache->dirty = false;
+    cache->pinned = false;
     cache->is_start = list_empty(&cache_list);
     cache->block = block;
     block_read(fs_device,sector,cache->buffer);
@@ -101,6 +102,32 @@ void cache_write(struct block *block, block_sector_t sector, const void *buffer)
     lock_release(&cache_lock);
 }
 
+/* Like cache_write(), but also pins SECTOR in the cache so that
+   it is not written back to disk until cache_flush(). */
+void cache_write_pin(struct block *block, block_sector_t sector, const void *buffer){
+    lock_acquire(&cache_lock);
+    struct cache_entry *target = is_hit(sector);
+    if(target == NULL){ //not - HIT
+        target = set_cache(block, sector);
+    }
+    memcpy(target->buffer,buffer,BLOCK_SECTOR_SIZE);
+    target->dirty = true;
+    target->pinned = true;
+    lock_release(&cache_lock);
+}
+
+/* Writes SECTOR back to disk if it is cached and dirty, and
+   unpins it. */
+void cache_flush(block_sector_t sector){
+    lock_acquire(&cache_lock);
+    struct cache_entry *target = is_hit(sector);
+    if(target != NULL){
+        cache_write_back(target);
+        target->pinned = false;
+    }
+    lock_release(&cache_lock);
+}
+
 /* read from BLOCK SECTOR's cache into BUFFER */
 void cache_read(struct block *block, block_sector_t sector, void *buffer){
     lock_acquire(&cache_lock);
@@ -16,6 +16,7 @@ struct cache_entry{
     bool dirty;
     bool accessed;
     bool is_start;
+    bool pinned;                        /* Held in the cache by the journal. */
     char buffer[CACHE_SECTOR_SIZE];
     struct block *block;
     block_sector_t block_idx;
@@ -29,6 +30,8 @@ void cache_write_back(struct cache_entry *);
 void cache_evict(void);
 struct cache_entry * set_cache(struct block *, block_sector_t);
 void cache_write(struct block *, block_sector_t, const void *);
+void cache_write_pin(struct block *, block_sector_t, const void *);
+void cache_flush(block_sector_t);
 void cache_read(struct block *, block_sector_t, void *);
 void cache_exit(void);
 
@@ -0,0 +1,196 @@
+#include "filesys/dcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Maximum number of cached entries.  Beyond this, the least
+   recently used entry is recycled. */
+#define DCACHE_SIZE 256
+
+/* A cached lookup of NAME in the directory at sector PARENT. */
+struct dcache_entry
+  {
+    struct hash_elem hash_elem;         /* Element in dcache_table. */
+    struct list_elem lru_elem;          /* Element in dcache_lru. */
+    block_sector_t parent;              /* Directory's inode sector. */
+    char name[NAME_MAX + 1];            /* Name looked up. */
+    bool exists;                        /* False for a negative entry. */
+    block_sector_t child;               /* NAME's inode sector if EXISTS. */
+  };
+
+static struct hash dcache_table;        /* Entries by (parent, name). */
+static struct list dcache_lru;          /* Most recently used first. */
+static size_t dcache_cnt;               /* Number of entries. */
+static struct lock dcache_lock;         /* Protects all of the above. */
+
+static hash_hash_func dcache_hash;
+static hash_less_func dcache_less;
+static struct dcache_entry *dcache_find (block_sector_t, const char *);
+static void dcache_remove (struct dcache_entry *);
+
+/* Initializes the directory entry cache. */
+void
+dcache_init (void)
+{
+  hash_init (&dcache_table, dcache_hash, dcache_less, NULL);
+  list_init (&dcache_lru);
+  dcache_cnt = 0;
+  lock_init (&dcache_lock);
+}
+
+/* Looks up NAME in the directory at sector PARENT.  On a hit,
+   sets *EXISTS to whether the entry exists and, if so, *CHILD to
+   its inode sector, and returns true.  Returns false on a miss,
+   in which case the caller must search the directory. */
+bool
+dcache_lookup (block_sector_t parent, const char *name,
+               bool *exists, block_sector_t *child)
+{
+  struct dcache_entry *e;
+
+  lock_acquire (&dcache_lock);
+  e = dcache_find (parent, name);
+  if (e != NULL)
+    {
+      *exists = e->exists;
+      *child = e->child;
+      list_remove (&e->lru_elem);
+      list_push_front (&dcache_lru, &e->lru_elem);
+    }
+  lock_release (&dcache_lock);
+  return e != NULL;
+}
+
+/* Records that NAME in the directory at sector PARENT does or
+   does not exist, per EXISTS, with inode sector CHILD. */
+void
+dcache_insert (block_sector_t parent, const char *name,
+               bool exists, block_sector_t child)
+{
+  struct dcache_entry *e;
+
+  if (strlen (name) > NAME_MAX)
+    return;
+
+  lock_acquire (&dcache_lock);
+  e = dcache_find (parent, name);
+  if (e != NULL)
+    list_remove (&e->lru_elem);
+  else
+    {
+      if (dcache_cnt >= DCACHE_SIZE)
+        {
+          /* Recycle the least recently used entry. */
+          e = list_entry (list_back (&dcache_lru),
+                          struct dcache_entry, lru_elem);
+          dcache_remove (e);
+        }
+      else
+        e = malloc (sizeof *e);
+      if (e == NULL)
+        {
+          lock_release (&dcache_lock);
+          return;
+        }
+      e->parent = parent;
+      strlcpy (e->name, name, sizeof e->name);
+      hash_insert (&dcache_table, &e->hash_elem);
+      dcache_cnt++;
+    }
+  e->exists = exists;
+  e->child = child;
+  list_push_front (&dcache_lru, &e->lru_elem);
+  lock_release (&dcache_lock);
+}
+
+/* Forgets whatever is cached for NAME in the directory at
+   sector PARENT. */
+void
+dcache_invalidate (block_sector_t parent, const char *name)
+{
+  struct dcache_entry *e;
+
+  lock_acquire (&dcache_lock);
+  e = dcache_find (parent, name);
+  if (e != NULL)
+    {
+      dcache_remove (e);
+      free (e);
+    }
+  lock_release (&dcache_lock);
+}
+
+/* Forgets every entry cached for the directory at sector
+   PARENT.  Called when that directory is removed, since its
+   sector may later be reused. */
+void
+dcache_purge_dir (block_sector_t parent)
+{
+  struct list_elem *e, *next;
+
+  lock_acquire (&dcache_lock);
+  for (e = list_begin (&dcache_lru); e != list_end (&dcache_lru); e = next)
+    {
+      struct dcache_entry *de = list_entry (e, struct dcache_entry, lru_elem);
+      next = list_next (e);
+      if (de->parent == parent)
+        {
+          dcache_remove (de);
+          free (de);
+        }
+    }
+  lock_release (&dcache_lock);
+}
+
+/* Returns the entry for NAME in PARENT, or a null pointer.
+   dcache_lock must be held. */
+static struct dcache_entry *
+dcache_find (block_sector_t parent, const char *name)
+{
+  struct dcache_entry key;
+  struct hash_elem *e;
+
+  if (strlen (name) > NAME_MAX)
+    return NULL;
+  key.parent = parent;
+  strlcpy (key.name, name, sizeof key.name);
+  e = hash_find (&dcache_table, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct dcache_entry, hash_elem) : NULL;
+}
+
+/* Unlinks E from the cache without freeing it.
+   dcache_lock must be held. */
+static void
+dcache_remove (struct dcache_entry *e)
+{
+  hash_delete (&dcache_table, &e->hash_elem);
+  list_remove (&e->lru_elem);
+  dcache_cnt--;
+}
+
+/* Hashes an entry's parent sector and name. */
+static unsigned
+dcache_hash (const struct hash_elem *e_, void *aux UNUSED)
+{
+  const struct dcache_entry *e
+    = hash_entry (e_, struct dcache_entry, hash_elem);
+  return hash_string (e->name) ^ hash_int (e->parent);
+}
+
+/* Orders entries by parent sector, then by name. */
+static bool
+dcache_less (const struct hash_elem *a_, const struct hash_elem *b_,
+             void *aux UNUSED)
+{
+  const struct dcache_entry *a
+    = hash_entry (a_, struct dcache_entry, hash_elem);
+  const struct dcache_entry *b
+    = hash_entry (b_, struct dcache_entry, hash_elem);
+  if (a->parent != b->parent)
+    return a->parent < b->parent;
+  return strcmp (a->name, b->name) < 0;
+}
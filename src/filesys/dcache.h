@@ -0,0 +1,24 @@
+#ifndef FILESYS_DCACHE_H
+#define FILESYS_DCACHE_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* Directory entry cache.
+
+   Remembers the result of looking up a name in a directory,
+   keyed by the directory's inode sector and the name, so that
+   resolving the same path again does not have to search the
+   directory on disk.  Negative results ("no such entry") are
+   cached too.  dir_add() and dir_remove() keep the cache
+   coherent. */
+
+void dcache_init (void);
+bool dcache_lookup (block_sector_t parent, const char *name,
+                    bool *exists, block_sector_t *child);
+void dcache_insert (block_sector_t parent, const char *name,
+                    bool exists, block_sector_t child);
+void dcache_invalidate (block_sector_t parent, const char *name);
+void dcache_purge_dir (block_sector_t parent);
+
+#endif /* filesys/dcache.h */
@@ -2,8 +2,12 @@
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+#include <hash.h>
+#include <round.h>
+#include "filesys/dcache.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 #include "threads/thread.h"
 
@@ -19,9 +23,80 @@ struct dir_entry
   {
     block_sector_t inode_sector;        /* Sector number of header. */
     char name[NAME_MAX + 1];            /* Null terminated file name. */
-    bool in_use;                        /* In use or free? */
+    bool in_use : 1;                    /* In use or free? */
+    bool is_dir : 1;                    /* Names a directory? */
   };
 
+/* A directory starts out as a flat array of entries, the first of
+   which only records the parent directory ("linear" format).
+   Once it outgrows its first sector it is converted to the
+   hashed format: sector 0 holds a struct dir_header and the
+   sectors after it each hold one bucket of entries, selected by
+   the hash of the entry's name.
+
+   The table grows by linear hashing.  Whenever a new entry does
+   not fit in its bucket, bucket number `split' is split: the
+   entries whose hash has bit bucket_cnt set move to a new bucket
+   bucket_cnt + split at the end, and `split' advances.  Once
+   every bucket has been split, bucket_cnt doubles and `split'
+   starts over at 0.  Each split touches only a few sectors, so
+   that it fits in one journal operation, however large the
+   directory. */
+#define DIR_INDEX_MAGIC 0x44494458      /* Marks a hashed directory. */
+#define DIR_MAX_BUCKETS 1024            /* Limit on directory growth. */
+#define BUCKET_ENTRIES (BLOCK_SECTOR_SIZE / sizeof (struct dir_entry))
+
+/* Sector 0 of a hashed directory. */
+struct dir_header
+  {
+    block_sector_t parent;              /* Same place as in entry 0. */
+    unsigned magic;                     /* DIR_INDEX_MAGIC. */
+    uint32_t bucket_cnt;                /* Power of 2, see above. */
+    uint32_t split;                     /* Next bucket to split. */
+  };
+
+/* One bucket of a hashed directory, exactly one sector long. */
+struct dir_bucket
+  {
+    struct dir_entry entries[BUCKET_ENTRIES];
+    uint8_t unused[BLOCK_SECTOR_SIZE
+                   - BUCKET_ENTRIES * sizeof (struct dir_entry)];
+  };
+
+static bool read_header (const struct dir *, struct dir_header *);
+static bool index_convert (struct dir *);
+static bool index_split (struct inode *, struct dir_header *);
+static off_t find_slot (struct dir *, const char *name);
+static bool readdir_locked (struct dir *, char name[NAME_MAX + 1]);
+
+/* Returns the byte offset of bucket B in a hashed directory. */
+static inline off_t
+bucket_ofs (uint32_t b)
+{
+  return (b + 1) * BLOCK_SECTOR_SIZE;
+}
+
+/* Returns the number of buckets in a hashed directory whose
+   header is *H. */
+static inline uint32_t
+bucket_total (const struct dir_header *h)
+{
+  return h->bucket_cnt + h->split;
+}
+
+/* Returns the bucket for NAME in a hashed directory whose header
+   is *H. */
+static inline uint32_t
+name_bucket (const char *name, const struct dir_header *h)
+{
+  unsigned hash = hash_string (name);
+  uint32_t b = hash & (h->bucket_cnt - 1);
+
+  if (b < h->split)
+    b = hash & (2 * h->bucket_cnt - 1);
+  return b;
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -34,6 +109,7 @@ dir_create (block_sector_t sector, size_t entry_cnt)
   struct inode* default_inode = inode_open(sector);
   struct dir * dir = dir_open(default_inode);
   struct dir_entry e;
+  memset (&e, 0, sizeof e);
   e.inode_sector = sector;
   success = (inode_write_at(dir->inode,&e,sizeof(struct dir_entry),0) == sizeof(struct dir_entry));
   dir_close(dir);
@@ -104,11 +180,42 @@ lookup (const struct dir *dir, const char *name,
         struct dir_entry *ep, off_t *ofsp) 
 {
   struct dir_entry e;
+  struct dir_header h;
   size_t ofs;
   
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
+  if (read_header (dir, &h))
+    {
+      /* Hashed: only NAME's bucket can contain it. */
+      struct dir_bucket *bucket = malloc (sizeof *bucket);
+      uint32_t b = name_bucket (name, &h);
+      bool found = false;
+      size_t i;
+
+      if (bucket == NULL
+          || inode_read_at (dir->inode, bucket, sizeof *bucket,
+                            bucket_ofs (b)) != sizeof *bucket)
+        {
+          free (bucket);
+          return false;
+        }
+      for (i = 0; i < BUCKET_ENTRIES; i++)
+        if (bucket->entries[i].in_use
+            && !strcmp (name, bucket->entries[i].name))
+          {
+            if (ep != NULL)
+              *ep = bucket->entries[i];
+            if (ofsp != NULL)
+              *ofsp = bucket_ofs (b) + i * sizeof e;
+            found = true;
+            break;
+          }
+      free (bucket);
+      return found;
+    }
+
   for (ofs = sizeof(e); inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
        ofs += sizeof e) 
     if (e.in_use && !strcmp (name, e.name)) 
@@ -146,11 +253,19 @@ dir_lookup (const struct dir *dir, const char *name,
       * inode = inode_open(e.inode_sector);
     }
   }
-  else if (lookup (dir, name, &e, NULL)){
-    *inode = inode_open (e.inode_sector);
-  }
   else{
-    *inode = NULL;
+    block_sector_t parent = inode_get_inumber (dir->inode);
+    block_sector_t child;
+    bool exists;
+
+    inode_lock_dir (dir->inode);
+    if (!dcache_lookup (parent, name, &exists, &child)){
+      exists = lookup (dir, name, &e, NULL);
+      child = exists ? e.inode_sector : 0;
+      dcache_insert (parent, name, exists, child);
+    }
+    *inode = exists ? inode_open (child) : NULL;
+    inode_unlock_dir (dir->inode);
   }
   return *inode != NULL;
 }
@@ -159,8 +274,9 @@ dir_lookup (const struct dir *dir, const char *name,
    file by that name.  The file's inode is in sector
    INODE_SECTOR.
    Returns true if successful, false on failure.
-   Fails if NAME is invalid (i.e. too long) or a disk or memory
-   error occurs. */
+   Fails if NAME is invalid (i.e. too long), if DIR has been
+   removed, if DIR has no room for another entry (see
+   dir_make_room()), or if a disk or memory error occurs. */
 bool
 dir_add (struct dir *dir, const char *name, block_sector_t inode_sector, int is_dir)
 {
@@ -175,45 +291,46 @@ dir_add (struct dir *dir, const char *name, block_sector_t inode_sector, int is_
   if (*name == '\0' || strlen (name) > NAME_MAX)
     return false;
 
-  /* Check that NAME is not in use. */
-  if (lookup (dir, name, NULL, NULL)){
+  /* Check that DIR still exists and NAME is not in use. */
+  journal_begin ();
+  inode_lock_dir (dir->inode);
+  if (inode_is_removed (dir->inode) || lookup (dir, name, NULL, NULL)){
     goto done;
   }
+  ofs = find_slot (dir, name);
+  if (ofs < 0)
+    goto done;
 
   if(is_dir){
     //get parent
+    memset (&e, 0, sizeof e);
     e.inode_sector = inode_get_inumber(dir_get_inode(dir));
     //get subdir
     subdir = dir_open(inode_open(inode_sector));
     if(subdir == NULL)
-      return false;
+      goto done;
     
     size_t size = inode_write_at(subdir->inode, &e, sizeof(e),0); 
     dir_close(subdir);
     if(size != sizeof(e))
-      return false;
+      goto done;
   }
 
-
-  /* Set OFS to offset of free slot.
-     If there are no free slots, then it will be set to the
-     current end-of-file.
-     
-     inode_read_at() will only return a short read at end of file.
-     Otherwise, we'd need to verify that we didn't get a short
-     read due to something intermittent such as low memory. */
-  for (ofs = 0; inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
-       ofs += sizeof e) 
-    if (!e.in_use)
-      break;
-
   /* Write slot. */
+  memset (&e, 0, sizeof e);
   e.in_use = true;
+  e.is_dir = is_dir != 0;
   strlcpy (e.name, name, sizeof e.name);
   e.inode_sector = inode_sector;
   success = inode_write_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+  if (success)
+    dcache_insert (inode_get_inumber (dir->inode), name, true, inode_sector);
+  else
+    dcache_invalidate (inode_get_inumber (dir->inode), name);
 
  done:
+  inode_unlock_dir (dir->inode);
+  journal_end ();
   return success;
 }
 
@@ -226,11 +343,14 @@ dir_remove (struct dir *dir, const char *name)
   struct dir_entry e;
   struct inode *inode = NULL;
   bool success = false;
+  bool is_dir = false;
   off_t ofs;
 
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
   /* Find directory entry. */
+  journal_begin ();
+  inode_lock_dir (dir->inode);
   if (!lookup (dir, name, &e, &ofs))
     goto done;
 
@@ -238,51 +358,49 @@ dir_remove (struct dir *dir, const char *name)
   inode = inode_open (e.inode_sector);
   if (inode == NULL)
     goto done;
-  if(inode_is_dir(inode)){
-    bool is_empty = true;
-    struct dir * subdir = dir_open(inode); //similar to readdir
+  if(inode_is_dir (inode)){
+    struct dir subdir;
 
     // not allow to rm cwd
     if(thread_current()->dir != NULL && inode_get_inumber(inode) == inode_get_inumber(dir_get_inode(thread_current()->dir))){
-      dir_close(subdir);
       goto done;
     } 
     
     //if opened by another process
-    if(thread_current()->dir != NULL && inode_open_cnt(subdir->inode)>2){
-      dir_close(subdir);
+    if(thread_current()->dir != NULL && inode_open_cnt(inode)>2){
       goto done;
     }
 
-    off_t temp= sizeof(e);
-    
-    while (inode_read_at (subdir->inode, &e, sizeof e, temp) == sizeof e) 
-      {
-        temp += sizeof e;
-        if (e.in_use)
-          {
-            is_empty = false;
-          } 
-      }
-    if(!is_empty){
-      // printf("not empty\n");
-      dir_close(subdir);
+    /* Hold the subdirectory's lock until it is marked removed,
+       so that nothing can be added to it after it is found
+       empty. */
+    char entry_name[NAME_MAX + 1];
+    is_dir = true;
+    inode_lock_dir (inode);
+    subdir.inode = inode;
+    subdir.pos = sizeof (struct dir_entry);
+    if (readdir_locked (&subdir, entry_name))
       goto done;
-    }
-    // printf("empty\n");
-    dir_close(subdir);
   }
   /* Erase directory entry. */
   e.in_use = false;
   if (inode_write_at (dir->inode, &e, sizeof e, ofs) != sizeof e) 
     goto done;
 
+  dcache_insert (inode_get_inumber (dir->inode), name, false, 0);
+  if (is_dir)
+    dcache_purge_dir (e.inode_sector);
+
   /* Remove inode. */
   inode_remove (inode);
   success = true;
 
  done:
+  if (is_dir)
+    inode_unlock_dir (inode);
+  inode_unlock_dir (dir->inode);
   inode_close (inode);
+  journal_end ();
   return success;
 }
 
@@ -291,8 +409,49 @@ dir_remove (struct dir *dir, const char *name)
    contains no more entries. */
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
+{
+  bool success;
+
+  inode_lock_dir (dir->inode);
+  success = readdir_locked (dir, name);
+  inode_unlock_dir (dir->inode);
+  return success;
+}
+
+/* Does the work of dir_readdir() for a caller that holds DIR's
+   directory lock. */
+static bool
+readdir_locked (struct dir *dir, char name[NAME_MAX + 1])
 {
   struct dir_entry e;
+  struct dir_header h;
+
+  if (read_header (dir, &h))
+    {
+      off_t end = bucket_ofs (bucket_total (&h));
+
+      if (dir->pos < bucket_ofs (0))
+        dir->pos = bucket_ofs (0);
+      while (dir->pos < end)
+        {
+          /* Skip the unused tail of each bucket. */
+          if (dir->pos % BLOCK_SECTOR_SIZE
+              >= (off_t) (BUCKET_ENTRIES * sizeof e))
+            {
+              dir->pos = ROUND_UP (dir->pos, BLOCK_SECTOR_SIZE);
+              continue;
+            }
+          if (inode_read_at (dir->inode, &e, sizeof e, dir->pos) != sizeof e)
+            break;
+          dir->pos += sizeof e;
+          if (e.in_use)
+            {
+              strlcpy (name, e.name, NAME_MAX + 1);
+              return true;
+            }
+        }
+      return false;
+    }
 
   while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
     {
@@ -305,3 +464,302 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
     }
   return false;
 }
+
+/* Reads up to CNT entries from DIR into ENTS, starting where the
+   last dir_readdir() or dir_getdents() call left off.  Entries
+   are read a bucket (or, in a linear directory, a bucket's worth)
+   at a time under a single acquisition of DIR's lock.  Returns
+   the number of entries stored, which is 0 at the end of DIR, or
+   -1 if memory allocation fails. */
+int
+dir_getdents (struct dir *dir, struct dirent *ents, size_t cnt)
+{
+  struct dir_bucket *chunk;
+  struct dir_header h;
+  bool hashed;
+  off_t first, end;
+  size_t n = 0;
+
+  chunk = malloc (sizeof *chunk);
+  if (chunk == NULL)
+    return -1;
+
+  inode_lock_dir (dir->inode);
+  hashed = read_header (dir, &h);
+  first = hashed ? bucket_ofs (0) : (off_t) sizeof (struct dir_entry);
+  end = hashed ? bucket_ofs (bucket_total (&h)) : inode_length (dir->inode);
+  if (dir->pos < first)
+    dir->pos = first;
+  while (n < cnt && dir->pos < end)
+    {
+      off_t limit, size;
+      size_t chunk_cnt, i;
+
+      /* In a hashed directory, stop short of each bucket's unused
+         tail. */
+      if (hashed)
+        limit = (ROUND_DOWN (dir->pos, BLOCK_SECTOR_SIZE)
+                 + BUCKET_ENTRIES * sizeof (struct dir_entry));
+      else
+        limit = dir->pos + BUCKET_ENTRIES * sizeof (struct dir_entry);
+      if (limit > end)
+        limit = end;
+      if (dir->pos >= limit)
+        {
+          dir->pos = ROUND_UP (dir->pos, BLOCK_SECTOR_SIZE);
+          continue;
+        }
+
+      size = inode_read_at (dir->inode, chunk->entries, limit - dir->pos,
+                            dir->pos);
+      chunk_cnt = size / sizeof (struct dir_entry);
+      if (chunk_cnt == 0)
+        break;
+      for (i = 0; i < chunk_cnt && n < cnt; i++)
+        {
+          struct dir_entry *e = &chunk->entries[i];
+
+          if (!e->in_use)
+            continue;
+          ents[n].d_ino = e->inode_sector;
+          strlcpy (ents[n].d_name, e->name, sizeof ents[n].d_name);
+          ents[n].d_is_dir = e->is_dir;
+          n++;
+        }
+      dir->pos += i * sizeof (struct dir_entry);
+    }
+  inode_unlock_dir (dir->inode);
+
+  free (chunk);
+  return n;
+}
+
+/* Reads DIR's header into *H and returns true if DIR is in the
+   hashed format, false if it is linear. */
+static bool
+read_header (const struct dir *dir, struct dir_header *h)
+{
+  return (inode_read_at (dir->inode, h, sizeof *h, 0) == sizeof *h
+          && h->magic == DIR_INDEX_MAGIC);
+}
+
+/* Returns the byte offset at which a new entry for NAME should
+   be written in DIR, or -1 if DIR has to grow first (see
+   dir_make_room()) or memory is short. */
+static off_t
+find_slot (struct dir *dir, const char *name)
+{
+  struct dir_header h;
+  struct dir_bucket *bucket;
+  struct dir_entry e;
+  uint32_t b;
+  off_t ofs = -1;
+  size_t i;
+
+  if (!read_header (dir, &h))
+    {
+      /* Set OFS to offset of free slot.
+         If there are no free slots, then it will be set to the
+         current end-of-file.
+
+         inode_read_at() will only return a short read at end of
+         file.  Otherwise, we'd need to verify that we didn't get
+         a short read due to something intermittent such as low
+         memory. */
+      for (ofs = sizeof e;
+           inode_read_at (dir->inode, &e, sizeof e, ofs) == sizeof e;
+           ofs += sizeof e) 
+        if (!e.in_use)
+          return ofs;
+
+      /* Stay linear while the directory fits in one sector. */
+      return ofs + sizeof e <= BLOCK_SECTOR_SIZE ? ofs : -1;
+    }
+
+  bucket = malloc (sizeof *bucket);
+  if (bucket == NULL)
+    return -1;
+  b = name_bucket (name, &h);
+  if (inode_read_at (dir->inode, bucket, sizeof *bucket, bucket_ofs (b))
+      == sizeof *bucket)
+    for (i = 0; i < BUCKET_ENTRIES; i++)
+      if (!bucket->entries[i].in_use)
+        {
+          ofs = bucket_ofs (b) + i * sizeof e;
+          break;
+        }
+  free (bucket);
+  return ofs;
+}
+
+/* Makes sure that DIR has room for a new entry named NAME,
+   growing it as needed.  Returns true if successful, false if
+   DIR cannot grow because it is at its maximum size or memory or
+   disk space is short.  If GROWN is nonnull, sets *GROWN to
+   whether DIR had to grow.
+
+   Growing a large directory logs more sectors than a journal
+   operation may, so this must be called outside any operation.
+   Each step of the growth is an operation of its own, and leaves
+   DIR consistent.  Call it just before starting the operation
+   that calls dir_add().  Another thread can still use up the room
+   in between, so if dir_add() fails, calling this again and
+   finding *GROWN set means that it is worth trying again. */
+bool
+dir_make_room (struct dir *dir, const char *name, bool *grown)
+{
+  bool success = true;
+  bool done = false;
+
+  ASSERT (thread_current ()->journal_depth == 0);
+
+  if (grown != NULL)
+    *grown = false;
+  while (success && !done)
+    {
+      struct dir_header h;
+
+      journal_begin ();
+      inode_lock_dir (dir->inode);
+      if (inode_is_removed (dir->inode) || find_slot (dir, name) >= 0)
+        done = true;
+      else
+        {
+          success = (read_header (dir, &h)
+                     ? index_split (dir->inode, &h)
+                     : index_convert (dir));
+          if (grown != NULL)
+            *grown = true;
+        }
+      inode_unlock_dir (dir->inode);
+      journal_end ();
+    }
+  return success;
+}
+
+/* Rewrites linear directory DIR in the hashed format, with
+   buckets at most about half full.  Returns true if successful,
+   false if out of memory (DIR is then left unchanged). */
+static bool
+index_convert (struct dir *dir)
+{
+  off_t length = inode_length (dir->inode);
+  size_t old_cnt = length / sizeof (struct dir_entry);
+  struct dir_entry *old = malloc (length);
+  struct dir_bucket *buckets = NULL;
+  struct dir_header h;
+  size_t used = 0, i;
+  bool success = false;
+
+  ASSERT (sizeof *buckets == BLOCK_SECTOR_SIZE);
+
+  if (old == NULL || inode_read_at (dir->inode, old, length, 0) != length)
+    goto done;
+  for (i = 1; i < old_cnt; i++)
+    if (old[i].in_use)
+      used++;
+
+  h.parent = old[0].inode_sector;
+  h.magic = DIR_INDEX_MAGIC;
+  h.split = 0;
+  for (h.bucket_cnt = 1; h.bucket_cnt * BUCKET_ENTRIES < 2 * (used + 1);
+       h.bucket_cnt *= 2)
+    continue;
+
+  /* Distribute the entries, doubling again if a bucket
+     overflows. */
+  for (;;)
+    {
+      bool overflow = false;
+
+      if (h.bucket_cnt > DIR_MAX_BUCKETS)
+        goto done;
+      free (buckets);
+      buckets = calloc (h.bucket_cnt, sizeof *buckets);
+      if (buckets == NULL)
+        goto done;
+      for (i = 1; i < old_cnt && !overflow; i++)
+        if (old[i].in_use)
+          {
+            struct dir_bucket *b
+              = &buckets[name_bucket (old[i].name, &h)];
+            size_t j;
+
+            for (j = 0; j < BUCKET_ENTRIES; j++)
+              if (!b->entries[j].in_use)
+                break;
+            if (j < BUCKET_ENTRIES)
+              b->entries[j] = old[i];
+            else
+              overflow = true;
+          }
+      if (!overflow)
+        break;
+      h.bucket_cnt *= 2;
+    }
+
+  /* Buckets first, then the header that makes them visible. */
+  length = h.bucket_cnt * sizeof *buckets;
+  success = (inode_write_at (dir->inode, buckets, length, bucket_ofs (0))
+             == length
+             && inode_write_at (dir->inode, &h, sizeof h, 0) == sizeof h);
+
+ done:
+  free (buckets);
+  free (old);
+  return success;
+}
+
+/* Splits the next bucket of the hashed directory whose inode is
+   INODE and whose header is *H, moving the entries that now
+   belong in a new bucket at the end of the directory there, and
+   updates *H.  Returns true if successful, false if the
+   directory is at its maximum size or memory or disk space is
+   short.  The new bucket is written first: it is the only write
+   that can fail, and until the header is updated nothing looks
+   at it. */
+static bool
+index_split (struct inode *inode, struct dir_header *h)
+{
+  struct dir_header new_h = *h;
+  uint32_t cnt = h->bucket_cnt;
+  struct dir_bucket *lo, *hi;
+  bool success = false;
+  size_t i;
+
+  if (bucket_total (h) >= DIR_MAX_BUCKETS)
+    return false;
+  lo = malloc (sizeof *lo);
+  hi = malloc (sizeof *hi);
+  if (lo == NULL || hi == NULL
+      || (inode_read_at (inode, lo, sizeof *lo, bucket_ofs (h->split))
+          != sizeof *lo))
+    goto done;
+
+  memset (hi, 0, sizeof *hi);
+  for (i = 0; i < BUCKET_ENTRIES; i++)
+    if (lo->entries[i].in_use
+        && (hash_string (lo->entries[i].name) & cnt) != 0)
+      {
+        hi->entries[i] = lo->entries[i];
+        lo->entries[i].in_use = false;
+      }
+
+  if (++new_h.split == cnt)
+    {
+      new_h.bucket_cnt = cnt * 2;
+      new_h.split = 0;
+    }
+  success = (inode_write_at (inode, hi, sizeof *hi, bucket_ofs (cnt + h->split))
+             == sizeof *hi
+             && (inode_write_at (inode, lo, sizeof *lo, bucket_ofs (h->split))
+                 == sizeof *lo)
+             && inode_write_at (inode, &new_h, sizeof new_h, 0) == sizeof new_h);
+  if (success)
+    *h = new_h;
+
+ done:
+  free (lo);
+  free (hi);
+  return success;
+}
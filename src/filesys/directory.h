@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <dirent.h>
 #include "devices/block.h"
 
 /* Maximum length of a file name component.
@@ -23,8 +24,10 @@ struct inode *dir_get_inode (struct dir *);
 
 /* Reading and writing. */
 bool dir_lookup (const struct dir *, const char *name, struct inode **);
+bool dir_make_room (struct dir *, const char *name, bool *grown);
 bool dir_add (struct dir *, const char *name, block_sector_t, int dir);
 bool dir_remove (struct dir *, const char *name);
 bool dir_readdir (struct dir *, char name[NAME_MAX + 1]);
+int dir_getdents (struct dir *, struct dirent *, size_t cnt);
 
 #endif /* filesys/directory.h */
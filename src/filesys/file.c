@@ -114,6 +114,17 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Extends FILE to at least LENGTH bytes and allocates disk space
+   for all of its first LENGTH bytes up front.
+   Returns true if successful, false if writes to FILE are denied
+   or the disk is full.
+   The file's current position is unaffected. */
+bool
+file_allocate (struct file *file, off_t length)
+{
+  return inode_allocate (file->inode, length);
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
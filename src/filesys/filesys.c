@@ -8,6 +8,8 @@
 #include "filesys/inode.h"
 #include "filesys/directory.h"
 #include "filesys/cache.h"
+#include "filesys/dcache.h"
+#include "filesys/journal.h"
 
 /* Partition that contains the file system. */
 struct block *fs_device;
@@ -26,7 +28,8 @@ filesys_init (bool format)
   inode_init ();
   free_map_init ();
   cache_init();
-  lock_init(&filesys_lock);
+  dcache_init ();
+  journal_init (format);
 
   if (format) 
     do_format ();
@@ -39,6 +42,7 @@ filesys_init (bool format)
 void
 filesys_done (void) 
 {
+  journal_done ();
   free_map_close ();
   cache_exit();
 }
@@ -50,47 +54,42 @@ filesys_done (void)
 bool
 filesys_create (const char *name, off_t initial_size, int is_dir) 
 {
-  lock_acquire(&filesys_lock);
-  // printf("create : %s\n",name);
+  char filename[NAME_MAX + 1];
   block_sector_t inode_sector = 0;
-  char * filename = (char*)calloc(1,128);
-  char * dirname = (char*)calloc(1,128);
-  char * newname = (char*)calloc(1,128);
-  split_name(name, filename, dirname);
-  if(is_dir && strlen(filename)==0){
-    int i;
-    for(i = strlen(name)-1; i>=0; i--){
-      if(name[i]!='/')
-        break;
-    }
-    strlcpy(newname, name, i+1);
-    split_name(newname, filename, dirname);
-  }
+  size_t len = strlen (name);
 
-  if(!strcmp(filename,".") || !strcmp(filename,"..")){
+  /* "a/b/" may only name a directory. */
+  if (!is_dir && len > 0 && name[len - 1] == '/')
     return false;
-  }
-  // printf("new: %s file: %s dir: %s\n",name, filename, dirname);
-  if(strlen(filename)>14){
-    free(filename);
-    free(dirname);
-    lock_release(&filesys_lock);
+
+  struct dir* dir = filesys_walk (name, filename);
+  if (dir == NULL || filename[0] == '\0'
+      || !strcmp(filename,".") || !strcmp(filename,"..")){
+    dir_close (dir);
     return false;
   }
-  // printf("open_dir : %s\n",dirname);
-  struct dir* dir = open_directories(dirname);
-  // printf("create : %p\n", dir);
-  bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
-                  && inode_create (inode_sector, initial_size,is_dir)
-                  && dir_add (dir, filename, inode_sector, is_dir)); 
-  if (!success && inode_sector != 0)
-    free_map_release (inode_sector, 1);
+
+  /* Growing DIR is too big to be part of the same journal
+     operation, so it happens first.  If another thread takes the
+     room before we do, grow again and retry. */
+  bool success = false;
+  bool retry = dir_make_room (dir, filename, NULL);
+  while (retry)
+    {
+      inode_sector = 0;
+      journal_begin ();
+      success = (free_map_allocate_near (1, inode_get_inumber (dir_get_inode (dir)),
+                                         &inode_sector)
+                 && inode_create (inode_sector, initial_size,is_dir)
+                 && dir_add (dir, filename, inode_sector, is_dir));
+      if (!success && inode_sector != 0)
+        free_map_release (inode_sector, 1);
+      journal_end ();
+      if (success || !dir_make_room (dir, filename, &retry))
+        break;
+    }
   dir_close (dir);
 
-  free(filename);
-  free(dirname);
-  lock_release(&filesys_lock);
   return success;
 }
 
@@ -102,40 +101,44 @@ filesys_create (const char *name, off_t initial_size, int is_dir)
 struct file *
 filesys_open (const char *name)
 {
-  lock_acquire(&filesys_lock);
-  // printf("open : %s\n",name);
-  char * filename = (char*)calloc(1,128);
-  char * dirname = (char*)calloc(1,128);
+  return file_open (filesys_lookup (name));
+}
+
+/* Returns the inode of the file named NAME, which the caller must
+   close, or a null pointer if there is no such file. */
+struct inode *
+filesys_lookup (const char *name)
+{
+  char filename[NAME_MAX + 1];
   struct inode *inode = NULL;
-  if(strlen(name)==0){
-    free(filename);
-    free(dirname);
-    lock_release(&filesys_lock);  
+
+  if(strlen(name)==0)
     return NULL;
-  }
-  split_name(name, filename, dirname);
-  // printf("open dirname : %s, filename : %s\n",dirname, filename);
-  struct dir* dir = open_directories(dirname);
+
+  struct dir* dir = filesys_walk (name, filename);
   if(dir == NULL){
-    lock_release(&filesys_lock);
     return NULL;
   }
-  // if(dir!=NULL){
-  // }
-  if(strlen(filename)==0){
-    inode = dir_get_inode(dir);
-  }
-  else{
+  if(filename[0] == '\0')
+    inode = inode_reopen (dir_get_inode (dir));   /* "/" */
+  else
     dir_lookup (dir, filename, &inode);
-    dir_close (dir);
-  }
-  // if(inode == NULL || inode_is_removed(inode))
-  //   return NULL;
-  free(filename);
-  free(dirname);
-  lock_release(&filesys_lock);
-  // printf("open success : %s\n",name);
-  return file_open (inode);
+  dir_close (dir);
+  return inode;
+}
+
+/* Stores information about the file named NAME into *ST.
+   Returns false if there is no such file. */
+bool
+filesys_stat (const char *name, struct stat *st)
+{
+  struct inode *inode = filesys_lookup (name);
+
+  if (inode == NULL)
+    return false;
+  inode_stat (inode, st, 1);    /* Don't count our own reference. */
+  inode_close (inode);
+  return true;
 }
 
 /* Deletes the file named NAME.
@@ -145,28 +148,20 @@ filesys_open (const char *name)
 bool
 filesys_remove (const char *name) 
 {
-  lock_acquire(&filesys_lock);
-  char * filename = (char*)calloc(1,128);
-  char * dirname = (char*)calloc(1,128);
-  split_name(name, filename, dirname);
-  struct dir* dir = open_directories(dirname);
+  char filename[NAME_MAX + 1];
+
+  struct dir* dir = filesys_walk (name, filename);
   if(dir == NULL){
-    lock_release(&filesys_lock);
     return false;
   }
 
-  bool success = dir_remove(dir,filename);
+  journal_begin ();
+  bool success = filename[0] != '\0' && dir_remove(dir,filename);
+  journal_end ();
   dir_close (dir); 
-  free(filename);
-  free(dirname);
-  // if(success)
-  //   printf("remove success : %s\n",name);
-  // else
-  //   printf("remove failed : %s\n",name);
-  lock_release(&filesys_lock);
   return success;
 }
-
+
 /* Formats the file system. */
 static void
 do_format (void)
@@ -180,101 +175,102 @@ do_format (void)
 }
 
 
-void split_name(char* name, char* filename, char* dirname){
-  int i;
-  for(i=strlen(name)-1;i>=0;i--){
-    if(name[i]=='/')
-      break;
-    }
-  if(i==-1){ // name에 '/'이 없을 때 : filename만 들어올 때 
-    strlcpy(filename,name,strlen(name)+1);
-    return;
-  }
+/* Extracts the next file name component from *SRCP into PART
+   and advances *SRCP past it, skipping any slashes before and
+   after.  Returns 1 if successful, 0 at the end of the string,
+   -1 if the component is longer than NAME_MAX characters. */
+static int
+get_next_part (char part[NAME_MAX + 1], const char **srcp)
+{
+  const char *src = *srcp;
+  char *dst = part;
 
-  // if(i==0){
-  //   memcpy(dirname,");
-  //   // dirname[1] = "\0";
-  // }
-  // else{
-  strlcpy(dirname,name,i+2);
-  // }
+  while (*src == '/')
+    src++;
+  if (*src == '\0')
+    return 0;
 
-  if(i!=strlen(name)-1){  // '/'뒷부분은 filename
-    strlcpy(filename,name+i+1,strlen(name)-i);
-  }
-  return NULL;
-}
+  while (*src != '/' && *src != '\0')
+    {
+      if (dst < part + NAME_MAX)
+        *dst++ = *src;
+      else
+        return -1;
+      src++;
+    }
+  *dst = '\0';
 
-char * contin_slash(char * dirname){
-  if(strlen(dirname) >1 )
-    if(dirname[0]=='/' && dirname[1]=='/')
-      return dirname+1;
-  return dirname;
+  *srcp = src;
+  return 1;
 }
 
+/* Walks PATH, which is absolute if it starts with "/" and
+   otherwise relative to the current thread's directory, down to
+   the directory that holds its last component.  Copies the last
+   component into NAME, or sets NAME to "" if PATH has no
+   components (e.g. "/").  Returns that directory, which the
+   caller must close, or a null pointer if some intermediate
+   component is missing, is not a directory or is too long.
 
-/* 아직 split안된 dirname을 하나하나 열기 */
-struct dir * open_directories(char* dirname){
-  char * new_dirname =  contin_slash(dirname);
-  char *token, save_ptr;
-  char * temp = (char*)calloc(1,128);
-  strlcpy(temp,new_dirname,strlen(new_dirname)+1);
-  struct dir* abs_dir = NULL;
-  struct dir* temp_dir = NULL;
-  if(strlen(new_dirname)==0){ //file name만 들어왔으면 현재 directory return
-    // return dir_open_root;
-    if(thread_current()->dir != NULL){
-      // printf(" cur dir : %p\n", thread_current()->dir);
-      abs_dir = dir_reopen(thread_current()->dir);
-      // printf(" absdir : %p\n", abs_dir);
-      return abs_dir;
-    }
-    abs_dir = dir_open_root();
-    // printf("root : %p\n",abs_dir);
-    return abs_dir;
-  }
+   The path is parsed in place: no memory is allocated besides
+   the directories opened along the way. */
+struct dir *
+filesys_walk (const char *path, char name[NAME_MAX + 1])
+{
+  char part[NAME_MAX + 1];
+  struct dir *dir;
+  int result;
 
-  if(temp[0] == '/'){ // absolute path
-    abs_dir = dir_open_root();
-    // printf("%p\n",abs_dir);
-  }
-  else if(thread_current()->dir == NULL){ // current thread is main
-    abs_dir = dir_open_root();
-  }
-  else{
-    abs_dir = dir_reopen(thread_current()->dir);
-  }
+  if (path[0] == '/' || thread_current ()->dir == NULL)
+    dir = dir_open_root ();
+  else
+    dir = dir_reopen (thread_current ()->dir);
 
-  int i =0;
-  //dirname을 /로 나눠가면서 dir_open하기 
-  for (token = strtok_r (temp, "/", &save_ptr); token != NULL;
-        token = strtok_r (NULL, "/", &save_ptr))
+  name[0] = '\0';
+  while (dir != NULL && (result = get_next_part (part, &path)) != 0)
     {
-      if(i++ ==0 && strlen(token)==0){
-        continue;
-      }
-      if(strlen(token)==0){
-        break;
-      }
-      struct inode* temp_inode = NULL;
-      bool temp_bool = dir_lookup(abs_dir,token,&temp_inode);
-      if(!temp_bool){
-        // printf("not found : %s\n",token);
-        dir_close(abs_dir); 
-        return NULL; //존재하지 않는 directory의 경우 return null
-      }
-      else{
-        temp_dir = dir_open(temp_inode);
-        if(temp_dir == NULL){
-            dir_close(abs_dir);
-            return NULL;
+      if (result < 0)
+        {
+          dir_close (dir);
+          return NULL;
+        }
+
+      /* PART is not last, so NAME must be a directory. */
+      if (name[0] != '\0')
+        {
+          struct inode *inode = NULL;
+          bool found = dir_lookup (dir, name, &inode);
+
+          dir_close (dir);
+          if (!found || !inode_is_dir (inode))
+            {
+              inode_close (inode);
+              return NULL;
+            }
+          dir = dir_open (inode);
         }
-        // abs_dir = dir_open(temp_inode);
-        dir_close(abs_dir);
-        abs_dir = temp_dir;
-        
-      }
+      strlcpy (name, part, NAME_MAX + 1);
     }
-  free(temp);
-  return abs_dir;
-}
\ No newline at end of file
+  return dir;
+}
+
+/* Opens and returns the directory named by PATH, or a null
+   pointer if it does not exist or is not a directory. */
+struct dir *
+open_directories (const char *path)
+{
+  char name[NAME_MAX + 1];
+  struct inode *inode = NULL;
+  struct dir *dir = filesys_walk (path, name);
+
+  if (dir == NULL || name[0] == '\0')
+    return dir;
+  dir_lookup (dir, name, &inode);
+  dir_close (dir);
+  if (inode != NULL && !inode_is_dir (inode))
+    {
+      inode_close (inode);
+      return NULL;
+    }
+  return dir_open (inode);
+}
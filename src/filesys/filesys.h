@@ -2,7 +2,9 @@
 #define FILESYS_FILESYS_H
 
 #include <stdbool.h>
+#include <stat.h>
 #include <filesys/file.h>
+#include "filesys/directory.h"
 #include <list.h>
 #include "filesys/off_t.h"
 #include "threads/synch.h"
@@ -10,16 +12,15 @@
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
 #define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
+#define JOURNAL_SECTOR 2        /* First sector of metadata journal. */
 
 /* Block device that contains the file system. */
 extern struct block *fs_device;
-struct lock filesys_lock;
 
 struct file_descriptor
 {
   int fd;
   struct file* file;
-  struct list_elem elem;
   struct dir* dir;
 };
 
@@ -29,10 +30,11 @@ void filesys_init (bool format);
 void filesys_done (void);
 bool filesys_create (const char *name, off_t initial_size, int dir);
 struct file *filesys_open (const char *name);
+struct inode *filesys_lookup (const char *name);
+bool filesys_stat (const char *name, struct stat *);
 bool filesys_remove (const char *name);
 
-void split_name(char*, char*, char*);
-char * contin_slash(char * );
-struct dir * open_directories(char*);
+struct dir *filesys_walk (const char *path, char name[NAME_MAX + 1]);
+struct dir * open_directories(const char*);
 
 #endif /* filesys/filesys.h */
@@ -1,12 +1,41 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
+#include <stdint.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* Sectors per allocation group.  The free map keeps a summary of
+   how many sectors are free in each group so that allocation can
+   skip full groups without looking at their bits. */
+#define GROUP_SECTORS 64
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static struct lock free_map_lock;    /* Protects free_map and groups. */
+
+/* Allocation group summary.  A complete binary tree stored in an
+   array: leaf GROUP_LEAVES + G holds the number of free sectors
+   in group G, and every inner node holds the maximum of its two
+   children, so the first group at or after a given one with at
+   least N free sectors can be found in O(log n). */
+static size_t group_cnt;             /* Number of allocation groups. */
+static size_t group_leaves;          /* Leaves in tree, a power of 2. */
+static uint16_t *group_tree;         /* Free counts, 2 * group_leaves. */
+
+static void group_update (size_t group);
+static void group_update_range (block_sector_t, size_t cnt);
+static void group_build (void);
+static size_t group_find (size_t first, size_t cnt);
+static block_sector_t group_scan (size_t group, block_sector_t start,
+                                  size_t cnt);
+static block_sector_t group_scan_span (size_t first, size_t last,
+                                       size_t cnt);
 
 /* Initializes the free map. */
 void
@@ -15,8 +44,19 @@ free_map_init (void)
   free_map = bitmap_create (block_size (fs_device));
   if (free_map == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
+  lock_init (&free_map_lock);
+
+  group_cnt = DIV_ROUND_UP (bitmap_size (free_map), GROUP_SECTORS);
+  for (group_leaves = 1; group_leaves < group_cnt; group_leaves *= 2)
+    continue;
+  group_tree = calloc (2 * group_leaves, sizeof *group_tree);
+  if (group_tree == NULL)
+    PANIC ("free map group summary allocation failed");
+
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+  group_build ();
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -27,14 +67,68 @@ free_map_init (void)
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+  return free_map_allocate_near (cnt, 0, sectorp);
+}
+
+/* Like free_map_allocate(), but prefers the first run of CNT free
+   sectors at or after GOAL, so that blocks of one file end up
+   next to each other and next to the file's inode.  If no such
+   run exists, wraps around to the start of the device.  Runs that
+   fit in one allocation group are looked for first; runs that
+   span groups are found from the group summary too, starting at
+   the goal's group. */
+bool
+free_map_allocate_near (size_t cnt, block_sector_t goal,
+                        block_sector_t *sectorp)
+{
+  block_sector_t sector = BITMAP_ERROR;
+  size_t first_group, group;
+
+  journal_begin ();
+  lock_acquire (&free_map_lock);
+  if (goal >= bitmap_size (free_map))
+    goal = 0;
+  first_group = goal / GROUP_SECTORS;
+
+  if (cnt <= GROUP_SECTORS)
+    {
+      /* The goal's own group, starting at the goal. */
+      if (group_tree[group_leaves + first_group] >= cnt)
+        sector = group_scan (first_group, goal, cnt);
+
+      /* Later groups, then wrap around to the start. */
+      for (group = group_find (first_group + 1, cnt);
+           sector == BITMAP_ERROR && group < group_cnt;
+           group = group_find (group + 1, cnt))
+        sector = group_scan (group, group * GROUP_SECTORS, cnt);
+      for (group = group_find (0, cnt);
+           sector == BITMAP_ERROR && group <= first_group;
+           group = group_find (group + 1, cnt))
+        sector = group_scan (group, group * GROUP_SECTORS, cnt);
+    }
+
+  /* Runs that are too long for one group, or that straddle a
+     group boundary. */
+  if (sector == BITMAP_ERROR)
+    sector = group_scan_span (first_group, group_cnt, cnt);
+  if (sector == BITMAP_ERROR)
+    sector = group_scan_span (0, first_group, cnt);
+
+  if (sector != BITMAP_ERROR)
+    {
+      bitmap_set_multiple (free_map, sector, cnt, true);
+      group_update_range (sector, cnt);
+    }
   if (sector != BITMAP_ERROR
       && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+      && !bitmap_write_range (free_map, free_map_file, sector, cnt))
     {
       bitmap_set_multiple (free_map, sector, cnt, false); 
+      group_update_range (sector, cnt);
       sector = BITMAP_ERROR;
     }
+  lock_release (&free_map_lock);
+  journal_end ();
   if (sector != BITMAP_ERROR)
     *sectorp = sector;
   return sector != BITMAP_ERROR;
@@ -44,9 +138,14 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  journal_begin ();
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
   bitmap_set_multiple (free_map, sector, cnt, false);
-  bitmap_write (free_map, free_map_file);
+  group_update_range (sector, cnt);
+  bitmap_write_range (free_map, free_map_file, sector, cnt);
+  lock_release (&free_map_lock);
+  journal_end ();
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -58,6 +157,8 @@ free_map_open (void)
     PANIC ("can't open free map");
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  ASSERT (bitmap_all (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS));
+  group_build ();
 }
 
 /* Writes the free map to disk and closes the free map file. */
@@ -72,15 +173,171 @@ free_map_close (void)
 void
 free_map_create (void) 
 {
+  struct file *file;
+
   /* Create inode. */
   
   if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map),0))
     PANIC ("free map creation failed");
   
-  /* Write bitmap to file. */
-  free_map_file = file_open (inode_open (FREE_MAP_SECTOR));
-  if (free_map_file == NULL)
+  /* Write bitmap to file.  The file starts out as a hole, so the
+     first write allocates its blocks, marking them in the map as
+     it goes; write it again once they are all in place. */
+  file = file_open (inode_open (FREE_MAP_SECTOR));
+  if (file == NULL)
     PANIC ("can't open free map");
-  if (!bitmap_write (free_map, free_map_file))
+  if (!bitmap_write (free_map, file) || !bitmap_write (free_map, file))
     PANIC ("can't write free map");
+  free_map_file = file;
+}
+
+/* Recomputes the free count of GROUP and propagates it up the
+   group summary tree. */
+static void
+group_update (size_t group)
+{
+  size_t start = group * GROUP_SECTORS;
+  size_t len = bitmap_size (free_map) - start;
+  size_t node;
+
+  if (len > GROUP_SECTORS)
+    len = GROUP_SECTORS;
+  node = group_leaves + group;
+  group_tree[node] = bitmap_count (free_map, start, len, false);
+  for (node /= 2; node > 0; node /= 2)
+    {
+      uint16_t left = group_tree[2 * node];
+      uint16_t right = group_tree[2 * node + 1];
+      group_tree[node] = left > right ? left : right;
+    }
+}
+
+/* Updates the summary of every group that overlaps the CNT
+   sectors starting at SECTOR. */
+static void
+group_update_range (block_sector_t sector, size_t cnt)
+{
+  size_t group;
+
+  if (cnt == 0)
+    return;
+  for (group = sector / GROUP_SECTORS;
+       group <= (sector + cnt - 1) / GROUP_SECTORS; group++)
+    group_update (group);
+}
+
+/* Rebuilds the whole group summary from the free map. */
+static void
+group_build (void)
+{
+  size_t group;
+
+  for (group = 0; group < group_cnt; group++)
+    group_update (group);
+}
+
+/* Returns the first group at or after FIRST with at least CNT
+   free sectors, or a value >= group_cnt if there is none. */
+static size_t
+group_find (size_t first, size_t cnt)
+{
+  size_t node;
+
+  if (first >= group_cnt)
+    return group_cnt;
+
+  /* Climb from FIRST's leaf until some subtree to the right of
+     the path has enough free sectors. */
+  node = group_leaves + first;
+  if (group_tree[node] >= cnt)
+    return first;
+  for (;;)
+    {
+      while (node % 2 == 1)
+        {
+          node /= 2;
+          if (node == 0)
+            return group_cnt;
+        }
+      node++;
+      if (group_tree[node] >= cnt)
+        break;
+    }
+
+  /* Descend to the leftmost leaf below NODE that qualifies. */
+  while (node < group_leaves)
+    node = group_tree[2 * node] >= cnt ? 2 * node : 2 * node + 1;
+  return node - group_leaves;
+}
+
+/* Searches GROUP, starting at sector START, for CNT consecutive
+   free sectors that lie entirely within the group.  Returns the
+   first such sector, or BITMAP_ERROR. */
+static block_sector_t
+group_scan (size_t group, block_sector_t start, size_t cnt)
+{
+  size_t end = (group + 1) * GROUP_SECTORS;
+  size_t i;
+
+  if (end > bitmap_size (free_map))
+    end = bitmap_size (free_map);
+  for (i = start; i + cnt <= end; i++)
+    if (!bitmap_contains (free_map, i, cnt, true))
+      return i;
+  return BITMAP_ERROR;
+}
+
+/* Returns the number of sectors in GROUP. */
+static size_t
+group_size (size_t group)
+{
+  size_t start = group * GROUP_SECTORS;
+  size_t size = bitmap_size (free_map) - start;
+
+  return size < GROUP_SECTORS ? size : GROUP_SECTORS;
+}
+
+/* Searches for CNT consecutive free sectors made up of the free
+   tail of one of groups FIRST through LAST - 1, any number of
+   completely free groups after it, and possibly the free head of
+   the group after those.  This finds every run that crosses a
+   group boundary, looking at the bits of only the groups at its
+   ends.  Returns the first sector of the first such run, or
+   BITMAP_ERROR. */
+static block_sector_t
+group_scan_span (size_t first, size_t last, size_t cnt)
+{
+  size_t group;
+
+  for (group = group_find (first, 1); group < last;
+       group = group_find (group, 1))
+    {
+      size_t end = group * GROUP_SECTORS + group_size (group);
+      size_t tail, avail, next, i;
+
+      /* Free tail of GROUP. */
+      for (tail = 0; tail < group_size (group); tail++)
+        if (bitmap_test (free_map, end - tail - 1))
+          break;
+
+      /* Completely free groups after it, then the head of the
+         first group that is not. */
+      avail = tail;
+      for (next = group + 1;
+           tail > 0 && avail < cnt && next < group_cnt
+             && group_tree[group_leaves + next] == group_size (next);
+           next++)
+        avail += group_size (next);
+      if (tail > 0 && avail < cnt && next < group_cnt)
+        for (i = next * GROUP_SECTORS;
+             avail < cnt && !bitmap_test (free_map, i); i++)
+          avail++;
+      if (avail >= cnt)
+        return end - tail;
+
+      /* A run starting in any of the free groups just skipped
+         would end at the same place, so it would be shorter. */
+      group = next;
+    }
+  return BITMAP_ERROR;
 }
@@ -1,28 +1,53 @@
 #include "filesys/inode.h"
 #include <list.h>
+#include <hash.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
 #include "filesys/cache.h"
 #include "threads/thread.h"
 #include "filesys/file.h"
 
 
-/* Identifies an inode. */
+/* Identify an inode whose data is in blocks, and one whose data
+   is inline (see INLINE_MAX). */
 #define INODE_MAGIC 0x494e4f44
-#define SECTOR_CNT BLOCK_SECTOR_SIZE/4
-#define DIRECT_CNT SECTOR_CNT - 5
-
-struct lock inode_lock;
+#define INODE_INLINE_MAGIC 0x494e4c4e
+#define SECTOR_CNT (BLOCK_SECTOR_SIZE / 4)
+#define DIRECT_CNT (SECTOR_CNT - 5)
+
+/* Files created no longer than INLINE_MAX bytes keep their data
+   in the inode sector itself, in place of the direct block
+   pointers, and own no data blocks.  Such an inode is marked with
+   INODE_INLINE_MAGIC.  A file moves to block-mapped storage, and
+   gets INODE_MAGIC, the first time it grows past INLINE_MAX
+   bytes. */
+#define INLINE_MAX ((off_t) (DIRECT_CNT * sizeof (block_sector_t)))
+
+/* Log sectors that one piece of a write may need besides the
+   sectors it writes: the inode, up to three index blocks and a
+   free map sector for each, and the first data block and its
+   free map sector if the file moves out of its inode. */
+#define PIECE_OVERHEAD 9
+
+/* Blocks preallocated per journal operation when they can come
+   out of one run of free sectors.  Such a piece logs the inode,
+   at most seven index blocks and two free map sectors. */
+#define ALLOC_PIECE (4 * SECTOR_CNT)
 
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
 struct inode_disk
   {
-    block_sector_t direct_sector[DIRECT_CNT];
+    union
+      {
+        block_sector_t direct_sector[DIRECT_CNT];
+        uint8_t inline_data[INLINE_MAX]; /* Data of a small file. */
+      };
     block_sector_t indirect_sector;
     block_sector_t double_indirect_sector;
     off_t length;                       /* File size in bytes. */
@@ -42,229 +67,267 @@ bytes_to_sectors (off_t size)
   return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE);
 }
 
+/* Returns true if DISK stores its data inline. */
+static inline bool
+is_inline (const struct inode_disk *disk)
+{
+  return disk->magic == INODE_INLINE_MAGIC;
+}
+
 /* In-memory inode. */
 struct inode 
   {
-    struct list_elem elem;              /* Element in inode list. */
+    struct hash_elem elem;              /* Element in open_inodes. */
     block_sector_t sector;              /* Sector number of disk location. */
     int open_cnt;                       /* Number of openers. */
+    bool loading;                       /* True while data is being read. */
+    struct condition loaded;            /* Signaled when data has been read. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    block_sector_t alloc_goal;          /* Where to look for the next block. */
+    block_sector_t resv_next;           /* Next sector of reserved run. */
+    block_sector_t resv_end;            /* End of reserved run. */
+    struct rwlock rwlock;               /* Guards data, incl. length. */
+    struct lock dir_lock;               /* Serializes directory updates. */
     struct inode_disk data;             /* Inode content. */
   };
 
+static block_sector_t lookup_block (struct inode *, size_t index,
+                                    bool create);
+static off_t write_piece (struct inode *, const uint8_t *buffer,
+                          off_t size, off_t offset);
+static bool allocate_piece (struct inode *, size_t *first, size_t end);
+
 /* Returns the block device sector that contains byte offset POS
-   within INODE.
-   Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
+   within INODE, which must be block-mapped and at least POS + 1
+   bytes long.  Returns 0 if POS lies in a hole, unless CREATE is
+   true, in which case the hole is filled first (0 then means the
+   disk is full). */
 static block_sector_t
-byte_to_sector (const struct inode *inode, off_t pos) 
+byte_to_sector (struct inode *inode, off_t pos, bool create) 
 {
   ASSERT (inode != NULL);
-  if (pos < inode->data.length)
-    return find_block(&inode->data, pos / BLOCK_SECTOR_SIZE);
-  else
-    return -1;
+  ASSERT (pos < inode->data.length);
+  return lookup_block (inode, pos / BLOCK_SECTOR_SIZE, create);
 }
 
-block_sector_t find_block(const struct inode_disk* disk,size_t index){
-  size_t cnt = index;
-  if(cnt < DIRECT_CNT ){
-    return disk->direct_sector[cnt];
-  }
-  cnt -= DIRECT_CNT;
+/* Open inodes, keyed by sector, so that opening a single inode
+   twice returns the same `struct inode'. */
+static struct hash open_inodes;
 
-  if(cnt < SECTOR_CNT){
-    struct indirect_block * indirect_block = calloc(1,sizeof(struct indirect_block));
-    cache_read(fs_device,disk->indirect_sector,indirect_block);
-    block_sector_t result = indirect_block->sectors[cnt];
-    free(indirect_block);
-    return result;
-  }
-  cnt -= SECTOR_CNT;
-
-  if(cnt < SECTOR_CNT*SECTOR_CNT){
-    size_t first_index = cnt/SECTOR_CNT;
-    size_t second_index = cnt%SECTOR_CNT;
-    struct indirect_block * indirect_block1 = calloc(1,sizeof(struct indirect_block));
-    cache_read(fs_device,disk->double_indirect_sector,indirect_block1);
-    
-    struct indirect_block * indirect_block2 = calloc(1,sizeof(struct indirect_block));
-    cache_read(fs_device,indirect_block1->sectors[first_index],indirect_block2);
-    
-    block_sector_t result = indirect_block2->sectors[second_index];
-    free(indirect_block1);
-    free(indirect_block2);
-    return result;
-  }
-  return -1; //fail
+/* Protects open_inodes and the open_cnt and loading of every open
+   inode. */
+static struct lock open_inodes_lock;
+
+/* Returns a hash value for inode E's sector. */
+static unsigned
+open_inode_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct inode, elem)->sector);
 }
 
-/* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
-static struct list open_inodes;
+/* Returns true if inode A's sector precedes inode B's. */
+static bool
+open_inode_less (const struct hash_elem *a, const struct hash_elem *b,
+                 void *aux UNUSED)
+{
+  return (hash_entry (a, struct inode, elem)->sector
+          < hash_entry (b, struct inode, elem)->sector);
+}
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
-  list_init (&open_inodes);
-  lock_init(&inode_lock);
+  hash_init (&open_inodes, open_inode_hash, open_inode_less, NULL);
+  lock_init (&open_inodes_lock);
 }
 
-size_t iterate_alloc(block_sector_t * sectors, off_t length, size_t size ){
-  static char empty[BLOCK_SECTOR_SIZE] = {0,};
-  size_t cnt = 0;
-  for(int i =0 ; i<length; i ++){
-    if(cnt == size)  
-      break;
-
-    if(!sectors[i]){
-      if (!free_map_allocate (1,&sectors[i]))
-        return cnt; 
-      cache_write(fs_device,sectors[i],empty);
-      cnt ++;
-    }
-  }
-  return cnt; 
+/* Returns true if INODE's data blocks hold metadata, that is,
+   if INODE is a directory or the free map. */
+static inline bool
+is_metadata (const struct inode *inode)
+{
+  return inode->data.is_dir || inode->sector == FREE_MAP_SECTOR;
 }
 
-size_t inode_alloc_indirect(block_sector_t * sectors, size_t size){
-  static char empty[BLOCK_SECTOR_SIZE] = {0,};
-  struct indirect_block *indirect_block = (struct indirect_block*) malloc(sizeof(struct indirect_block));
-  if(*sectors == 0){ 
-    free_map_allocate(1,sectors);
-    cache_write(fs_device,*sectors,empty);
-  }
+/* Returns the most data sectors that one journal operation may
+   write to, or allocate for, INODE.  Each may need a new block,
+   which logs a free map sector; if INODE holds metadata, the
+   sector itself is logged too. */
+static size_t
+piece_sectors (const struct inode *inode)
+{
+  return (JOURNAL_OP_SLOTS - PIECE_OVERHEAD) / (is_metadata (inode) ? 2 : 1);
+}
 
-  cache_read(fs_device,*sectors,indirect_block);
-  size_t cnt = iterate_alloc(indirect_block->sectors,SECTOR_CNT,size);
-  cache_write(fs_device,*sectors,indirect_block);
-  return cnt;
+/* Writes BUFFER to data block SECTOR of INODE, through the
+   journal if the block holds metadata. */
+static void
+write_data (struct inode *inode, block_sector_t sector, const void *buffer)
+{
+  if (is_metadata (inode))
+    journal_write (sector, buffer);
+  else
+    cache_write (fs_device, sector, buffer);
 }
 
+/* If *SLOT is a hole, fills it with the next sector of INODE's
+   reserved run, if it has one, or else with a newly allocated
+   sector as close after INODE's allocation goal as possible, and
+   advances the goal past it.  The sector is zeroed before it is
+   linked in, through the journal if META is true.  Returns false
+   if the disk is full. */
+static bool
+fill_slot (struct inode *inode, block_sector_t *slot, bool meta)
+{
+  static char zeros[BLOCK_SECTOR_SIZE];
+  block_sector_t sector;
 
-size_t inode_alloc_double(block_sector_t * sectors, size_t size){
-  static char empty[BLOCK_SECTOR_SIZE] = {0,};
-  struct indirect_block *doubly_blocks= (struct indirect_block*) malloc(sizeof(struct indirect_block)); 
-  size_t cnt = size;
-  if(*sectors == 0){ 
-    free_map_allocate(1,sectors);
-    cache_write(fs_device,*sectors,empty);
-  }
-  cache_read(fs_device,*sectors,doubly_blocks);
-
-  // //1st level allocation
-  // for(int i =0 ; i<SECTOR_CNT; i ++){
-  //   if(!doubly_blocks->sectors[i]){
-  //     // if (!free_map_allocate (1,&doubly_blocks->sectors[i]))
-  //       // return size - cnt;
-  //     free_map_allocate (1,&doubly_blocks->sectors[i]);
-  //     cache_write(fs_device,doubly_blocks->sectors[i],empty);
-  //   }
-  // }
-  
-  //second level allocation
-  for(int i=0; i<SECTOR_CNT ; i++){
-    cnt -= inode_alloc_indirect(&doubly_blocks->sectors[i],cnt);
-    if(cnt == 0){
-      // printf("!\n");
-      break;
-    }
-  }
+  if (*slot != 0)
+    return true;
+  if (inode->resv_next < inode->resv_end)
+    sector = inode->resv_next++;
+  else if (!free_map_allocate_near (1, inode->alloc_goal, &sector))
+    return false;
+  if (meta)
+    journal_write (sector, zeros);
+  else
+    cache_write (fs_device, sector, zeros);
+  inode->alloc_goal = sector + 1;
+  *slot = sector;
+  return true;
+}
 
-  cache_write(fs_device,*sectors,doubly_blocks);
-  return size-cnt;  
+/* Returns the sector that holds data block INDEX of INODE, or 0
+   if that block is a hole.  A pointer of 0 anywhere on the way
+   (in the inode or in an index block) means a hole, since sector
+   0 always holds the free map's inode.
 
-}
+   If CREATE is true, a hole is filled with a zeroed block,
+   along with any index blocks that are missing above it.  The
+   caller must then hold INODE's rwlock for writing and be inside
+   a journal operation, and 0 means the disk is full or memory is
+   short. */
+static block_sector_t
+lookup_block (struct inode *inode, size_t index, bool create)
+{
+  struct inode_disk *disk = &inode->data;
+  struct indirect_block *block;
+  block_sector_t *slot;
+  block_sector_t sector;
+  int levels;
 
-size_t inode_alloc(struct inode_disk* disk, size_t sectors){
-  lock_acquire(&inode_lock);
-  size_t cnt = sectors;
-  //direct
-  cnt -= iterate_alloc(disk->direct_sector,DIRECT_CNT,cnt);
-  if(cnt ==0){
-    lock_release(&inode_lock);
-    // lock_release(&filesys_lock);
-    return sectors;
-  }
-  //indirect
-  cnt -=inode_alloc_indirect(&disk->indirect_sector,cnt);
-  if(cnt ==0){
-    lock_release(&inode_lock);
-    // lock_release(&filesys_lock);  
-    return sectors;
-  }
-  //doubly indirect
-  cnt -= inode_alloc_double(&disk->double_indirect_sector,cnt);
+  if (index < DIRECT_CNT)
+    {
+      slot = &disk->direct_sector[index];
+      levels = 0;
+    }
+  else if ((index -= DIRECT_CNT) < SECTOR_CNT)
+    {
+      slot = &disk->indirect_sector;
+      levels = 1;
+    }
+  else if ((index -= SECTOR_CNT) < SECTOR_CNT * SECTOR_CNT)
+    {
+      slot = &disk->double_indirect_sector;
+      levels = 2;
+    }
+  else
+    return 0;
 
-  ASSERT(cnt == 0);
-  lock_release(&inode_lock);
-  return sectors - cnt;
+  /* The pointer in the inode itself. */
+  if (*slot == 0)
+    {
+      if (!create
+          || !fill_slot (inode, slot, levels > 0 || is_metadata (inode)))
+        return 0;
+      journal_write (inode->sector, disk);
+    }
+  sector = *slot;
+  if (levels == 0)
+    return sector;
 
-}
+  /* Pointers in index blocks. */
+  block = malloc (sizeof *block);
+  if (block == NULL)
+    return 0;
+  for (; levels > 0 && sector != 0; levels--)
+    {
+      size_t i = levels == 2 ? index / SECTOR_CNT : index % SECTOR_CNT;
 
-size_t iterate_free(block_sector_t * sectors, off_t length, size_t size ){
-  size_t cnt = 0;
-  for(int i =0 ; i<length; i ++){
-    if(cnt == size)  
-      break;
+      cache_read (fs_device, sector, block);
+      if (block->sectors[i] == 0 && create)
+        {
+          if (fill_slot (inode, &block->sectors[i],
+                         levels > 1 || is_metadata (inode)))
+            journal_write (sector, block);
+        }
+      sector = block->sectors[i];
+    }
+  free (block);
+  return sector;
+}
 
+/* Releases each allocated sector among the CNT in SECTORS. */
+void iterate_free(block_sector_t * sectors, size_t cnt){
+  for(size_t i =0 ; i<cnt; i ++){
     if(sectors[i]){
       free_map_release(sectors[i],1);
-      cnt ++;
     }
   }
-  return cnt; //length-cnt; 
 }
 
-size_t inode_free_indirect(block_sector_t *sectors, size_t size){
-  size_t cnt;
-  struct indirect_block *indirect_block;
-  if(*sectors != 0){
-    cache_read(fs_device,*sectors,indirect_block);
-    cnt = iterate_free(indirect_block->sectors,SECTOR_CNT,size);
+/* Releases the data blocks listed in index block SECTOR, then
+   SECTOR itself. */
+void inode_free_indirect(block_sector_t sector){
+  struct indirect_block *indirect_block = malloc(sizeof *indirect_block);
+  if(indirect_block != NULL){
+    cache_read(fs_device,sector,indirect_block);
+    iterate_free(indirect_block->sectors,SECTOR_CNT);
+    free(indirect_block);
   }
-  cache_write(fs_device,*sectors,indirect_block);
-  return cnt;
-  
+  free_map_release(sector,1);
 }
 
-size_t inode_free_double(block_sector_t *sectors, size_t size){
-  struct indirect_block *doubly_block;
-  size_t cnt = size;
-  if(*sectors != 0){
-    cache_read(fs_device,*sectors,doubly_block);
+/* Releases the index blocks listed in doubly indirect block
+   SECTOR along with their data blocks, then SECTOR itself. */
+void inode_free_double(block_sector_t sector){
+  struct indirect_block *doubly_block = malloc(sizeof *doubly_block);
+  if(doubly_block != NULL){
+    cache_read(fs_device,sector,doubly_block);
     for(int i = 0; i<SECTOR_CNT; i++){
-      cnt -= inode_free_indirect(doubly_block->sectors[i],cnt);
+      if(doubly_block->sectors[i])
+        inode_free_indirect(doubly_block->sectors[i]);
     }
-    cache_write(fs_device,*sectors,doubly_block);
+    free(doubly_block);
   }
-  return size - cnt;
+  free_map_release(sector,1);
 }
 
+/* Releases every block that DISK owns, skipping holes. */
 void inode_free(struct inode_disk* disk){
-  size_t sectors = bytes_to_sectors(disk->length);
+  if (is_inline (disk))
+    return;
 
   //direct
-  sectors -= iterate_free(disk->direct_sector,DIRECT_CNT,sectors);
-  if(sectors == 0)
-    return ;
+  iterate_free(disk->direct_sector,DIRECT_CNT);
 
   //indirect
-  sectors -= inode_free_indirect(disk->indirect_sector,sectors);
-  if(sectors == 0)
-    return ;
+  if(disk->indirect_sector)
+    inode_free_indirect(disk->indirect_sector);
 
   //doubly-indirect
-  sectors -= inode_free_double(disk->double_indirect_sector,sectors);
+  if(disk->double_indirect_sector)
+    inode_free_double(disk->double_indirect_sector);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
    writes the new inode to sector SECTOR on the file system
-   device.
+   device.  The data starts out as one hole that reads as zeros;
+   blocks are allocated only as they are written.
    Returns true if successful.
-   Returns false if memory or disk allocation fails. */
+   Returns false if memory allocation fails. */
 bool
 inode_create (block_sector_t sector, off_t length,int dir)
 {
@@ -277,15 +340,14 @@ inode_create (block_sector_t sector, off_t length,int dir)
   disk_inode = calloc (1, sizeof *disk_inode);
   if (disk_inode != NULL)
     {
-      size_t sectors = bytes_to_sectors (length);
       disk_inode->length = length;
-      disk_inode->magic = INODE_MAGIC;
+      disk_inode->magic = length <= INLINE_MAX ? INODE_INLINE_MAGIC
+                                               : INODE_MAGIC;
       disk_inode->is_dir = dir;
-      size_t alloc_sector = inode_alloc(disk_inode,sectors);
-      if(alloc_sector == sectors){
-        cache_write (fs_device, sector, disk_inode);
-        success = true;
-      } 
+      journal_begin ();
+      journal_write (sector, disk_inode);
+      journal_end ();
+      success = true;
       free (disk_inode);
     }
   return success;
@@ -293,39 +355,64 @@ inode_create (block_sector_t sector, off_t length,int dir)
 
 /* Reads an inode from SECTOR
    and returns a `struct inode' that contains it.
-   Returns a null pointer if memory allocation fails. */
+   Returns a null pointer if memory allocation fails.
+
+   The first opener reads the inode without holding
+   open_inodes_lock, so that opening one inode does not hold up
+   opening others.  Meanwhile the inode is marked as loading, and
+   anyone else opening it waits for the read to finish. */
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
+  struct inode key;
+  struct hash_elem *e;
   struct inode *inode;
+
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  lock_acquire (&open_inodes_lock);
+  key.sector = sector;
+  e = hash_find (&open_inodes, &key.elem);
+  if (e != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
+      inode = hash_entry (e, struct inode, elem);
+      inode->open_cnt++;
+      while (inode->loading)
+        cond_wait (&inode->loaded, &open_inodes_lock);
+      lock_release (&open_inodes_lock);
+      return inode;
     }
 
   /* Allocate memory. */
   inode = malloc (sizeof *inode);
   if (inode == NULL)
-    return NULL;
+    {
+      lock_release (&open_inodes_lock);
+      return NULL;
+    }
 
   /* Initialize. */
-  list_push_front (&open_inodes, &inode->elem);
   inode->sector = sector;
+  hash_insert (&open_inodes, &inode->elem);
   // list_init(&inode->t_list);
   inode->open_cnt = 1;
+  inode->loading = true;
+  cond_init (&inode->loaded);
   inode->deny_write_cnt = 0;
   inode->removed = false;
+  inode->alloc_goal = sector;
+  inode->resv_next = inode->resv_end = 0;
+  rwlock_init (&inode->rwlock);
+  lock_init (&inode->dir_lock);
   // lock_init(&inode->inode_thread_lock);
   // list_push_back(&inode->t_list,&create_inode_thread(thread_current()->tid)->elem);
+  lock_release (&open_inodes_lock);
+
   cache_read (fs_device, inode->sector, &inode->data);
+
+  lock_acquire (&open_inodes_lock);
+  inode->loading = false;
+  cond_broadcast (&inode->loaded, &open_inodes_lock);
+  lock_release (&open_inodes_lock);
   return inode;
 }
 
@@ -334,7 +421,9 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL){
+    lock_acquire (&open_inodes_lock);
     inode->open_cnt++;
+    lock_release (&open_inodes_lock);
     // reopen_inode_thread(inode, thread_current()->tid);
   }
   return inode;
@@ -360,19 +449,26 @@ inode_close (struct inode *inode)
   // inode->open_cnt --;
   // close_inode_thread(inode,thread_current()->tid);
   /* Release resources if this was the last opener. */
+  lock_acquire (&open_inodes_lock);
   if (--inode->open_cnt == 0)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
+      /* Remove from inode table and release lock. */
+      hash_delete (&open_inodes, &inode->elem);
+      lock_release (&open_inodes_lock);
+
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
+          journal_begin ();
           free_map_release (inode->sector, 1);
           inode_free(&inode->data);
+          journal_end ();
         }
 
       free (inode); 
     }
+  else
+    lock_release (&open_inodes_lock);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -393,10 +489,23 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
+
+  rwlock_acquire_read (&inode->rwlock);
+  if (is_inline (&inode->data))
+    {
+      /* Small file: the data is in the inode itself. */
+      off_t inode_left = inode_length (inode) - offset;
+      if (offset >= 0 && inode_left > 0)
+        {
+          bytes_read = size < inode_left ? size : inode_left;
+          memcpy (buffer, inode->data.inline_data + offset, bytes_read);
+        }
+      goto done;
+    }
   while (size > 0) 
     {
-      /* Disk sector to read, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Starting byte offset within sector. */
+      block_sector_t sector_idx;
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -407,7 +516,15 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       int chunk_size = size < min_left ? size : min_left;
       if (chunk_size <= 0)
         break;
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+
+      /* Disk sector to read. */
+      sector_idx = byte_to_sector (inode, offset, false);
+      if (sector_idx == 0)
+        {
+          /* A hole reads as zeros, without touching the disk. */
+          memset (buffer + bytes_read, 0, chunk_size);
+        }
+      else if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
           /* Read full sector directly into caller's buffer. */
           cache_read (fs_device, sector_idx, buffer + bytes_read);
@@ -431,39 +548,150 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+ done:
+  rwlock_release_read (&inode->rwlock);
   free (bounce);
   return bytes_read;
 }
 
+/* Moves the inline data of INODE, whose rwlock the caller holds
+   for writing, into a newly allocated first data block, leaving
+   INODE block-mapped with bytes_to_sectors (length) blocks.
+   Returns true if successful, false if out of memory or disk
+   space (INODE is then unchanged). */
+static bool
+inline_promote (struct inode *inode)
+{
+  struct inode_disk *disk = &inode->data;
+  uint8_t *block;
+  bool success = true;
+
+  block = calloc (1, BLOCK_SECTOR_SIZE);
+  if (block == NULL)
+    return false;
+  memcpy (block, disk->inline_data, disk->length);
+  memset (disk->direct_sector, 0, sizeof disk->direct_sector);
+  disk->magic = INODE_MAGIC;
+  if (disk->length > 0)
+    {
+      success = lookup_block (inode, 0, true) != 0;
+      if (success)
+        write_data (inode, disk->direct_sector[0], block);
+      else
+        {
+          memcpy (disk->inline_data, block, disk->length);
+          disk->magic = INODE_INLINE_MAGIC;
+        }
+    }
+  free (block);
+  return success;
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
-   less than SIZE if end of file is reached or an error occurs.
-   (Normally a write at end of file would extend the inode, but
-   growth is not yet implemented.) */
+   less than SIZE if the disk fills up or an error occurs.
+   A write past end of file extends the inode, leaving a hole
+   between the old end of file and OFFSET; only blocks that are
+   actually written get allocated.
+
+   The write is done a few sectors at a time (see piece_sectors()),
+   each piece its own journal operation, so that a large write
+   never overflows the journal.  After a crash, a file may hold
+   only a prefix of a large write, but is consistent. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
                 off_t offset) 
 {
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
-  uint8_t *bounce = NULL;
+  off_t piece_max = piece_sectors (inode) * BLOCK_SECTOR_SIZE;
+
   if (inode->deny_write_cnt)
     return 0;
-  
-  // if(inode->data.is_dir)
-  //   return -1;
+
+  do
+    {
+      /* End each piece on a sector boundary, so that it touches no
+         more than piece_sectors() sectors. */
+      off_t piece = piece_max - offset % BLOCK_SECTOR_SIZE;
+      off_t n;
+
+      if (piece > size)
+        piece = size;
+      n = write_piece (inode, buffer + bytes_written, piece, offset);
+
+      bytes_written += n;
+      offset += n;
+      size -= n;
+      if (n < piece)
+        break;
+    }
+  while (size > 0);
+  return bytes_written;
+}
+
+/* Does the work of inode_write_at() for one piece of a write.
+
+   Writes to existing blocks share INODE's rwlock with readers.
+   A write that extends the file or fills a hole holds it
+   exclusively until its data is in place, so that readers never
+   see the new length or block before the data.  So does any
+   write to an inline file, which changes the inode itself.
+
+   journal_begin() may sleep, so it comes before the rwlock.  Only
+   plain overwrites of a regular file's blocks leave the metadata
+   alone and need no journal operation; if a piece turns out to
+   need one after all, the rwlock is dropped while it starts. */
+static off_t
+write_piece (struct inode *inode, const uint8_t *buffer, off_t size,
+             off_t offset)
+{
+  off_t bytes_written = 0;
+  uint8_t *bounce = NULL;
+  bool exclusive, journaled = false;
+
+ retry:
+  rwlock_acquire_read (&inode->rwlock);
+  exclusive = (offset + size > inode->data.length
+               || is_inline (&inode->data));
+  if (!journaled && (exclusive || is_metadata (inode)))
+    {
+      rwlock_release_read (&inode->rwlock);
+      journal_begin ();
+      journaled = true;
+      goto retry;
+    }
+  if (exclusive)
+    {
+      rwlock_release_read (&inode->rwlock);
+      rwlock_acquire_write (&inode->rwlock);
+    }
+
   //extend file
   off_t extend =  offset + size - inode->data.length;
   if(extend > 0){ 
-    size_t sectors = bytes_to_sectors(extend);
-    inode_alloc(&inode->data,sectors);
-    inode->data.length += extend;
-    cache_write(fs_device,inode->sector,&inode->data);
+    off_t length = offset + size;
+    if (length > INLINE_MAX && is_inline (&inode->data)
+        && !inline_promote (inode))
+      goto done;
+    inode->data.length = length;
+    journal_write (inode->sector, &inode->data);
   }
+  if (is_inline (&inode->data))
+    {
+      /* Small file: update the inode and write it back. */
+      if (size > 0 && offset >= 0 && offset <= inode->data.length - size)
+        {
+          memcpy (inode->data.inline_data + offset, buffer, size);
+          journal_write (inode->sector, &inode->data);
+          bytes_written = size;
+        }
+      goto done;
+    }
   while (size > 0) 
     {
-      /* Sector to write, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Starting byte offset within sector. */
+      block_sector_t sector_idx;
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -476,10 +704,26 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (chunk_size <= 0)
         break;
 
+      /* Sector to write.  Filling a hole needs the rwlock for
+         writing, so trade up and look again. */
+      sector_idx = byte_to_sector (inode, offset, exclusive);
+      if (sector_idx == 0 && !exclusive)
+        {
+          rwlock_release_read (&inode->rwlock);
+          if (!journaled)
+            journal_begin ();
+          journaled = true;
+          rwlock_acquire_write (&inode->rwlock);
+          exclusive = true;
+          continue;
+        }
+      if (sector_idx == 0)
+        break;
+
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
         {
           /* Write full sector directly to disk. */
-          cache_write (fs_device, sector_idx, buffer + bytes_written);
+          write_data (inode, sector_idx, buffer + bytes_written);
         }
       else 
         {
@@ -499,7 +743,7 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
           else
             memset (bounce, 0, BLOCK_SECTOR_SIZE);
           memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          cache_write (fs_device, sector_idx, bounce);
+          write_data (inode, sector_idx, bounce);
         }
 
       /* Advance. */
@@ -507,10 +751,129 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
+ done:
+  if (journaled)
+    journal_end ();
+  if (exclusive)
+    rwlock_release_write (&inode->rwlock);
+  else
+    rwlock_release_read (&inode->rwlock);
   free (bounce);
   return bytes_written;
 }
 
+/* Returns an upper bound on the number of index blocks needed to
+   map the first SECTORS data blocks of an inode. */
+static size_t
+index_blocks (size_t sectors)
+{
+  size_t cnt = 0;
+
+  if (sectors > DIRECT_CNT)
+    cnt++;
+  if (sectors > DIRECT_CNT + SECTOR_CNT)
+    cnt += 1 + DIV_ROUND_UP (sectors - DIRECT_CNT - SECTOR_CNT, SECTOR_CNT);
+  return cnt;
+}
+
+/* Extends INODE to at least LENGTH bytes and allocates every
+   block of its first LENGTH bytes that is still a hole, so that
+   later writes there need no allocation.  This is done a piece
+   at a time, each piece its own journal operation, so that
+   preallocating a large file never overflows the journal.
+   Returns true if successful, false if writes to
+   INODE are denied or the disk fills up, in which case INODE may
+   be left partly allocated. */
+bool
+inode_allocate (struct inode *inode, off_t length)
+{
+  struct inode_disk *disk = &inode->data;
+  size_t sectors = 0, i;
+  bool success = true;
+
+  ASSERT (length >= 0);
+  if (inode->deny_write_cnt)
+    return false;
+
+  journal_begin ();
+  rwlock_acquire_write (&inode->rwlock);
+  if (length > disk->length)
+    {
+      if (length > INLINE_MAX && is_inline (disk) && !inline_promote (inode))
+        success = false;
+      else
+        {
+          disk->length = length;
+          journal_write (inode->sector, disk);
+        }
+    }
+  if (success && !is_inline (disk))
+    sectors = bytes_to_sectors (length);
+  rwlock_release_write (&inode->rwlock);
+  journal_end ();
+
+  for (i = 0; success && i < sectors; )
+    success = allocate_piece (inode, &i, sectors);
+  return success;
+}
+
+/* Allocates, as one journal operation, every hole among the
+   next data blocks of block-mapped INODE, starting at block
+   *FIRST and stopping before END, and advances *FIRST past them.
+   The blocks (and any index blocks they need) come out of a
+   single run of free sectors reserved up front, ALLOC_PIECE
+   blocks at a time.  If the disk has no run that long, they are
+   allocated one at a time as usual, but each one may then log a
+   free map sector of its own, so the piece is cut down to
+   piece_sectors() blocks.  Returns true if successful, false if
+   the disk fills up. */
+static bool
+allocate_piece (struct inode *inode, size_t *first, size_t end)
+{
+  size_t holes = 0, resv, i;
+  block_sector_t start;
+  bool success = true;
+
+  if (end - *first > ALLOC_PIECE)
+    end = *first + ALLOC_PIECE;
+
+  journal_begin ();
+  rwlock_acquire_write (&inode->rwlock);
+  for (i = *first; i < end; i++)
+    if (lookup_block (inode, i, false) == 0)
+      holes++;
+
+  /* Index blocks that map blocks on both sides of *FIRST (at
+     most two) are counted by neither index_blocks() call, so
+     allow for them too. */
+  resv = holes + index_blocks (end) - index_blocks (*first) + 2;
+  if (holes > 0
+      && free_map_allocate_near (resv, inode->alloc_goal, &start))
+    {
+      inode->resv_next = start;
+      inode->resv_end = start + resv;
+    }
+  else if (end - *first > piece_sectors (inode))
+    end = *first + piece_sectors (inode);
+  for (i = *first; i < end && holes > 0; i++)
+    if (lookup_block (inode, i, true) == 0)
+      {
+        success = false;
+        break;
+      }
+
+  /* Give back whatever the index blocks that already existed left
+     unused. */
+  if (inode->resv_next < inode->resv_end)
+    free_map_release (inode->resv_next, inode->resv_end - inode->resv_next);
+  inode->resv_next = inode->resv_end = 0;
+  *first = end;
+
+  rwlock_release_write (&inode->rwlock);
+  journal_end ();
+  return success;
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
@@ -565,6 +928,53 @@ int inode_open_cnt(struct inode* inode){
   return inode->open_cnt;
 }
 
+/* Stores INODE's length, number, type, open count and block
+   layout into *ST.  The open count leaves out the caller's own
+   OWN references.  The layout takes a walk over the whole block
+   map, reading every index block. */
+void
+inode_stat (struct inode *inode, struct stat *st, int own)
+{
+  block_sector_t prev = 0;
+  size_t i;
+
+  rwlock_acquire_read (&inode->rwlock);
+  st->st_size = inode_length (inode);
+  st->st_ino = inode->sector;
+  st->st_is_dir = inode->data.is_dir;
+  st->st_open_cnt = inode->open_cnt - own;
+  st->st_blocks = st->st_first_block = st->st_extents = 0;
+  if (!is_inline (&inode->data))
+    for (i = 0; i < bytes_to_sectors (inode_length (inode)); i++)
+      {
+        block_sector_t sector = lookup_block (inode, i, false);
+
+        if (sector == 0)
+          continue;
+        if (st->st_blocks++ == 0)
+          st->st_first_block = sector;
+        if (sector != prev + 1)
+          st->st_extents++;
+        prev = sector;
+      }
+  rwlock_release_read (&inode->rwlock);
+}
+
+/* Acquires the lock that serializes lookups and updates of the
+   directory whose inode is INODE. */
+void
+inode_lock_dir (struct inode *inode)
+{
+  lock_acquire (&inode->dir_lock);
+}
+
+/* Releases INODE's directory lock. */
+void
+inode_unlock_dir (struct inode *inode)
+{
+  lock_release (&inode->dir_lock);
+}
+
 // bool inode_can_remove(struct inode* inode){
 //   lock_acquire(&inode->inode_thread_lock);
 //   if(inode->open_cnt == 0 || list_size(&inode->t_list)==0){
@@ -2,6 +2,7 @@
 #define FILESYS_INODE_H
 
 #include <stdbool.h>
+#include <stat.h>
 #include "filesys/off_t.h"
 #include "devices/block.h"
 #include "filesys/file.h"
@@ -14,15 +15,10 @@ struct inode_disk;
 void inode_init (void);
 
 /* added */
-block_sector_t find_block(const struct inode_disk*, size_t);
-size_t iterate_alloc(block_sector_t *, off_t, size_t);
-size_t inode_alloc_indirect(block_sector_t *, size_t);
-size_t inode_alloc_double(block_sector_t *, size_t);
-size_t inode_alloc(struct inode_disk*, size_t);
 void inode_free(struct inode_disk*);
-size_t iterate_free(block_sector_t *, off_t, size_t);
-size_t inode_free_indirect(block_sector_t*, size_t);
-size_t inode_free_double(block_sector_t*, size_t);
+void iterate_free(block_sector_t *, size_t);
+void inode_free_indirect(block_sector_t);
+void inode_free_double(block_sector_t);
 
 bool inode_create (block_sector_t, off_t,int);
 struct inode *inode_open (block_sector_t);
@@ -32,6 +28,7 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+bool inode_allocate (struct inode *, off_t length);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
@@ -41,6 +38,9 @@ bool inode_is_dir(struct inode*);
 bool inode_is_removed(struct inode *);
 block_sector_t inode_to_inum(struct file*);
 int inode_open_cnt(struct inode* );
+void inode_stat (struct inode *, struct stat *, int own);
+void inode_lock_dir (struct inode *);
+void inode_unlock_dir (struct inode *);
 
 // bool inode_can_remove(struct inode*);
 // struct inode_thread* create_inode_thread(tid_t);
@@ -0,0 +1,215 @@
+#include "filesys/journal.h"
+#include <debug.h>
+#include <stdint.h>
+#include <string.h>
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Identifies a journal header. */
+#define JOURNAL_MAGIC 0x4a524e4c
+
+/* On-disk format version, kept in the journal header.  Change it
+   whenever the layout of inodes, directories or the journal
+   changes, so that disks in an older format are refused instead
+   of misread. */
+#define FORMAT_VERSION 2
+
+/* Commit once the log is this full and no operation is in
+   progress, rather than leaving it to journal_begin() to commit
+   when it finds no room. */
+#define COMMIT_THRESHOLD (JOURNAL_CAPACITY * 3 / 4)
+
+/* On-disk journal header, at JOURNAL_SECTOR.  The log itself
+   follows it: log block I is the committed copy of SECTORS[I].
+   The header also identifies the file system's format.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct journal_header
+  {
+    unsigned magic;                     /* JOURNAL_MAGIC. */
+    uint32_t version;                   /* FORMAT_VERSION. */
+    uint32_t cnt;                       /* Committed sectors, 0 if none. */
+    block_sector_t sectors[JOURNAL_CAPACITY]; /* Home locations. */
+    uint8_t unused[BLOCK_SECTOR_SIZE - 12 - 4 * JOURNAL_CAPACITY];
+  };
+
+/* Sectors written since the last commit, each pinned in the
+   buffer cache.  A sector written twice is logged once. */
+static block_sector_t log_sectors[JOURNAL_CAPACITY];
+static size_t log_cnt;
+
+/* Operations in progress, and the log sectors they have reserved
+   but not yet used.  log_cnt + reserved never exceeds
+   JOURNAL_CAPACITY. */
+static int outstanding;
+static size_t reserved;
+static struct condition room;           /* Signaled as slots free up. */
+
+static struct journal_header header;    /* Scratch header. */
+static struct lock journal_lock;        /* Protects all of the above. */
+
+static void commit (void);
+
+/* Initializes the journal.  Unless FORMAT is true, first checks
+   that the file system is in the current format, panicking if
+   not, then copies any committed sectors left in the journal by
+   a crash to their home locations.  Must be called before
+   anything else reads the file system. */
+void
+journal_init (bool format)
+{
+  ASSERT (sizeof header == BLOCK_SECTOR_SIZE);
+  lock_init (&journal_lock);
+  cond_init (&room);
+
+  if (!format)
+    {
+      block_read (fs_device, JOURNAL_SECTOR, &header);
+
+      /* A disk formatted before the journal existed keeps file data
+         where the journal now goes; never write over it. */
+      if (header.magic != JOURNAL_MAGIC || header.version != FORMAT_VERSION)
+        PANIC ("file system is in an old or unknown format; "
+               "reformat it with -f");
+      if (header.cnt <= JOURNAL_CAPACITY)
+        {
+          static uint8_t buf[BLOCK_SECTOR_SIZE];
+          size_t i;
+
+          for (i = 0; i < header.cnt; i++)
+            {
+              block_read (fs_device, JOURNAL_SECTOR + 1 + i, buf);
+              block_write (fs_device, header.sectors[i], buf);
+            }
+        }
+    }
+
+  memset (&header, 0, sizeof header);
+  header.magic = JOURNAL_MAGIC;
+  header.version = FORMAT_VERSION;
+  block_write (fs_device, JOURNAL_SECTOR, &header);
+}
+
+/* Commits everything logged so far.  Called at shutdown, before
+   the buffer cache is flushed. */
+void
+journal_done (void)
+{
+  lock_acquire (&journal_lock);
+  commit ();
+  lock_release (&journal_lock);
+}
+
+/* Starts an operation whose metadata writes should reach the
+   disk together.  Within an operation already in progress in
+   this thread, just nests.  Otherwise reserves JOURNAL_OP_SLOTS
+   log sectors for the new operation, first waiting for the
+   operations in progress to free up room or, if there are none,
+   committing.  The caller must therefore not hold any lock that
+   an operation in progress might wait for. */
+void
+journal_begin (void)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->journal_depth++ > 0)
+    return;
+
+  lock_acquire (&journal_lock);
+  while (log_cnt + reserved + JOURNAL_OP_SLOTS > JOURNAL_CAPACITY)
+    {
+      if (outstanding == 0)
+        commit ();
+      else
+        cond_wait (&room, &journal_lock);
+    }
+  outstanding++;
+  reserved += JOURNAL_OP_SLOTS;
+  cur->journal_slots = JOURNAL_OP_SLOTS;
+  lock_release (&journal_lock);
+}
+
+/* Ends an operation started with journal_begin() and gives back
+   the log sectors it did not use.  If it was the last operation
+   in progress and the log is filling up, commits. */
+void
+journal_end (void)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (cur->journal_depth > 0);
+  if (--cur->journal_depth > 0)
+    return;
+
+  lock_acquire (&journal_lock);
+  ASSERT (outstanding > 0);
+  reserved -= cur->journal_slots;
+  cur->journal_slots = 0;
+  if (--outstanding == 0 && log_cnt >= COMMIT_THRESHOLD)
+    commit ();
+  cond_broadcast (&room, &journal_lock);
+  lock_release (&journal_lock);
+}
+
+/* Writes BUFFER to metadata sector SECTOR as part of the
+   current operation.  A sector not yet in the log takes one of
+   the sectors the operation reserved or, once those are used up,
+   one that nobody has reserved.  There is always one to take as
+   long as operations stay within the bounds that the callers of
+   journal_begin() are designed for; running out is a bug. */
+void
+journal_write (block_sector_t sector, const void *buffer)
+{
+  struct thread *cur = thread_current ();
+  size_t i;
+
+  ASSERT (cur->journal_depth > 0);
+
+  lock_acquire (&journal_lock);
+  for (i = 0; i < log_cnt; i++)
+    if (log_sectors[i] == sector)
+      break;
+  if (i == log_cnt)
+    {
+      if (cur->journal_slots > 0)
+        {
+          cur->journal_slots--;
+          reserved--;
+        }
+      else if (log_cnt + reserved >= JOURNAL_CAPACITY)
+        PANIC ("metadata journal overflow");
+      log_sectors[log_cnt++] = sector;
+    }
+  cache_write_pin (fs_device, sector, buffer);
+  lock_release (&journal_lock);
+}
+
+/* Writes the logged sectors to the journal, then the header
+   that makes them count, then installs them at home and clears
+   the header.  The caller must hold journal_lock. */
+static void
+commit (void)
+{
+  static uint8_t buf[BLOCK_SECTOR_SIZE];
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+  if (log_cnt == 0)
+    return;
+
+  for (i = 0; i < log_cnt; i++)
+    {
+      cache_read (fs_device, log_sectors[i], buf);
+      block_write (fs_device, JOURNAL_SECTOR + 1 + i, buf);
+    }
+  header.cnt = log_cnt;
+  memcpy (header.sectors, log_sectors, log_cnt * sizeof *log_sectors);
+  block_write (fs_device, JOURNAL_SECTOR, &header);
+
+  for (i = 0; i < log_cnt; i++)
+    cache_flush (log_sectors[i]);
+  header.cnt = 0;
+  block_write (fs_device, JOURNAL_SECTOR, &header);
+  log_cnt = 0;
+}
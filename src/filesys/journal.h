@@ -0,0 +1,46 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* Metadata journal.
+
+   Writes to metadata sectors (inodes, index blocks, directory
+   blocks and the free map) go through journal_write() instead of
+   straight to the buffer cache.  The journal pins each such
+   sector in the cache and remembers it.  Once enough sectors
+   have been gathered and no operation is in progress, it commits
+   them as a group.  It copies them into the journal region at
+   JOURNAL_SECTOR, writes a header listing them, and only then
+   lets them go to their home locations.  filesys_init() replays
+   a committed but uninstalled group, so after a crash every
+   operation is either completely on disk or not at all.  The
+   journal header also records the on-disk format version, and
+   filesys_init() refuses a disk in any other format.
+
+   Each file system operation that changes metadata is bracketed
+   by journal_begin() and journal_end().  These calls nest.  The
+   outermost journal_begin() reserves JOURNAL_OP_SLOTS sectors of
+   the log for the operation, sleeping until the log has room for
+   them, so it must be called before taking any file system lock.
+   No operation logs more sectors than that and whatever is left
+   unreserved, so a commit never has to split one.  Jobs that
+   could log more, such as large writes, fallocate() and growing
+   a big directory, are done as a series of operations, each of
+   which leaves the file system consistent. */
+
+/* Sectors reserved for the journal: a header and the log. */
+#define JOURNAL_CAPACITY 32             /* Sectors per commit. */
+#define JOURNAL_SECTORS (1 + JOURNAL_CAPACITY)
+
+/* Log sectors reserved by each operation. */
+#define JOURNAL_OP_SLOTS 16
+
+void journal_init (bool format);
+void journal_done (void);
+void journal_begin (void);
+void journal_end (void);
+void journal_write (block_sector_t, const void *);
+
+#endif /* filesys/journal.h */
@@ -0,0 +1,18 @@
+#ifndef __LIB_DIRENT_H
+#define __LIB_DIRENT_H
+
+#include <stdbool.h>
+
+/* Maximum length of a name in a struct dirent.  Same as the
+   file system's NAME_MAX. */
+#define DIRENT_NAME_MAX 14
+
+/* One directory entry returned by getdents(). */
+struct dirent
+  {
+    int d_ino;                          /* Inode number. */
+    bool d_is_dir;                      /* Is it a directory? */
+    char d_name[DIRENT_NAME_MAX + 1];   /* Null terminated file name. */
+  };
+
+#endif /* lib/dirent.h */
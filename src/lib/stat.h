@@ -0,0 +1,18 @@
+#ifndef __LIB_STAT_H
+#define __LIB_STAT_H
+
+#include <stdbool.h>
+
+/* Information about a file returned by stat() and fstat(). */
+struct stat
+  {
+    int st_size;                /* Length in bytes. */
+    int st_ino;                 /* Inode number. */
+    bool st_is_dir;             /* Is it a directory? */
+    int st_open_cnt;            /* Number of times it is open. */
+    int st_blocks;              /* Number of data blocks allocated. */
+    int st_first_block;         /* Sector of first data block, or 0. */
+    int st_extents;             /* Runs of consecutive data blocks. */
+  };
+
+#endif /* lib/stat.h */
@@ -28,7 +28,17 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+
+    /* Extensions. */
+    SYS_READV,                  /* Read into several buffers. */
+    SYS_WRITEV,                 /* Write from several buffers. */
+    SYS_PREAD,                  /* Read from a given file position. */
+    SYS_PWRITE,                 /* Write at a given file position. */
+    SYS_GETDENTS,               /* Reads several directory entries. */
+    SYS_STAT,                   /* Gets information about a path. */
+    SYS_FSTAT,                  /* Gets information about an open file. */
+    SYS_FALLOCATE               /* Preallocates space for a file. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -3,6 +3,9 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <dirent.h>
+#include <iovec.h>
+#include <stat.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -45,4 +48,14 @@ bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
 
+/* Extensions. */
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, unsigned position);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned position);
+int getdents (int fd, struct dirent *ents, unsigned cnt);
+bool stat (const char *file, struct stat *st);
+bool fstat (int fd, struct stat *st);
+bool fallocate (int fd, unsigned length);
+
 #endif /* lib/user/syscall.h */
@@ -0,0 +1,9 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($tree);
+$tree->{"a"}{"sub"} = {};
+$tree->{"a"}{"f$_"} = [''] foreach 0...39;
+check_archive ($tree);
+pass;
@@ -0,0 +1,85 @@
+/* Fills a directory with enough entries to need several sectors,
+   then lists it with getdents() in small batches and checks that
+   every entry comes back exactly once with the right type and
+   inode number. */
+
+#include <syscall.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 40
+
+void
+test_main (void)
+{
+  bool seen[FILE_CNT + 1];
+  int inums[FILE_CNT + 1];
+  struct dirent ents[7];
+  int dir_fd, cnt, total = 0;
+  int i;
+
+  CHECK (mkdir ("a"), "mkdir \"a\"");
+  CHECK (mkdir ("a/sub"), "mkdir \"a/sub\"");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "a/f%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+  msg ("created %d files in \"a\"", FILE_CNT);
+
+  CHECK ((dir_fd = open ("a")) > 1, "open \"a\"");
+  memset (seen, 0, sizeof seen);
+  while ((cnt = getdents (dir_fd, ents, sizeof ents / sizeof *ents)) > 0)
+    for (i = 0; i < cnt; i++)
+      {
+        struct dirent *e = &ents[i];
+        int slot;
+
+        if (!strcmp (e->d_name, "sub"))
+          {
+            slot = FILE_CNT;
+            if (!e->d_is_dir)
+              fail ("\"sub\" not reported as a directory");
+          }
+        else
+          {
+            if (e->d_name[0] != 'f' || (slot = atoi (e->d_name + 1)) < 0
+                || slot >= FILE_CNT)
+              fail ("unexpected entry \"%s\"", e->d_name);
+            if (e->d_is_dir)
+              fail ("\"%s\" reported as a directory", e->d_name);
+          }
+        if (seen[slot])
+          fail ("\"%s\" listed twice", e->d_name);
+        seen[slot] = true;
+        inums[slot] = e->d_ino;
+        total++;
+      }
+  CHECK (cnt == 0, "getdents reached end of \"a\"");
+  CHECK (total == FILE_CNT + 1, "listed %d entries", FILE_CNT + 1);
+
+  CHECK (chdir ("a"), "chdir \"a\"");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      char name[16];
+      int fd;
+
+      snprintf (name, sizeof name, "f%d", i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      if (inumber (fd) != inums[i])
+        fail ("\"%s\" has inumber %d, getdents said %d",
+              name, inumber (fd), inums[i]);
+      close (fd);
+    }
+  msg ("inumbers match");
+
+  msg ("close \"a\"");
+  close (dir_fd);
+}
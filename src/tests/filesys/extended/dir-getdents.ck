@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-getdents) begin
+(dir-getdents) mkdir "a"
+(dir-getdents) mkdir "a/sub"
+(dir-getdents) created 40 files in "a"
+(dir-getdents) open "a"
+(dir-getdents) getdents reached end of "a"
+(dir-getdents) listed 41 entries
+(dir-getdents) chdir "a"
+(dir-getdents) inumbers match
+(dir-getdents) close "a"
+(dir-getdents) end
+EOF
+pass;
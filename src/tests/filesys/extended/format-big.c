@@ -0,0 +1,25 @@
+/* Runs on a file system of 80 MB, whose free map is too big to
+   be written in one journal operation, and checks that it was
+   formatted and that a file can be written and read back. */
+
+#include <syscall.h>
+#include "tests/filesys/seq-test.h"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[20000];
+
+static size_t
+return_block_size (void) 
+{
+  return 4096;
+}
+
+void
+test_main (void) 
+{
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+  seq_test ("d/file",
+            buf, sizeof buf, 0,
+            return_block_size, NULL);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(format-big) begin
+(format-big) mkdir "d"
+(format-big) create "d/file"
+(format-big) open "d/file"
+(format-big) writing "d/file"
+(format-big) close "d/file"
+(format-big) open "d/file" for verification
+(format-big) verified contents of "d/file"
+(format-big) close "d/file"
+(format-big) end
+EOF
+pass;
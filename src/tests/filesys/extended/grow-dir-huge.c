@@ -0,0 +1,60 @@
+/* Creates enough files in one directory that growing its hash
+   table touches more sectors than one journal commit holds, then
+   checks that every file can be opened and that readdir() lists
+   each of them exactly once. */
+
+#include <syscall.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 600
+
+void
+test_main (void)
+{
+  static bool seen[FILE_CNT];
+  char name[READDIR_MAX_LEN + 1];
+  int dir_fd, total = 0;
+  int i;
+
+  CHECK (mkdir ("/x"), "mkdir \"/x\"");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "/x/file%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+  msg ("created %d files in \"/x\"", FILE_CNT);
+
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "/x/file%d", i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+  msg ("opened all %d files", FILE_CNT);
+
+  CHECK ((dir_fd = open ("/x")) > 1, "open \"/x\"");
+  while (readdir (dir_fd, name))
+    {
+      int slot;
+
+      if (memcmp (name, "file", 4) || (slot = atoi (name + 4)) < 0
+          || slot >= FILE_CNT)
+        fail ("unexpected entry \"%s\"", name);
+      if (seen[slot])
+        fail ("\"%s\" listed twice", name);
+      seen[slot] = true;
+      total++;
+    }
+  CHECK (total == FILE_CNT, "readdir listed %d entries", FILE_CNT);
+
+  msg ("close \"/x\"");
+  close (dir_fd);
+}
@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-dir-huge) begin
+(grow-dir-huge) mkdir "/x"
+(grow-dir-huge) created 600 files in "/x"
+(grow-dir-huge) opened all 600 files
+(grow-dir-huge) open "/x"
+(grow-dir-huge) readdir listed 600 entries
+(grow-dir-huge) close "/x"
+(grow-dir-huge) end
+EOF
+pass;
@@ -0,0 +1,73 @@
+/* Preallocates a file past its direct blocks with fallocate()
+   and checks that it grew, reads back as zeros, and does not
+   shrink when asked for less space.  A big enough hole is left
+   free before the file's inode, and the blocks must go after
+   the inode anyway, in at most two runs (the indirect block
+   splits them). */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 70000
+#define PAD_SIZE 100000
+
+static char buf[4096];
+
+void
+test_main (void)
+{
+  struct stat st;
+  int fd, dir_fd;
+  size_t ofs;
+
+  CHECK (create ("pad", 0), "create \"pad\"");
+  CHECK ((fd = open ("pad")) > 1, "open \"pad\"");
+  for (ofs = 0; ofs < PAD_SIZE; ofs += sizeof buf)
+    if (write (fd, buf, sizeof buf) != (int) sizeof buf)
+      fail ("write \"pad\" at offset %zu failed", ofs);
+  msg ("close \"pad\"");
+  close (fd);
+
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK (remove ("pad"), "remove \"pad\"");
+  CHECK ((fd = open ("a")) > 1, "open \"a\"");
+  CHECK (fallocate (fd, FILE_SIZE), "fallocate \"a\" to %d bytes", FILE_SIZE);
+  CHECK (filesize (fd) == FILE_SIZE, "filesize \"a\" is %d", FILE_SIZE);
+
+  CHECK (fstat (fd, &st), "fstat \"a\"");
+  if (st.st_blocks != (FILE_SIZE + 511) / 512)
+    fail ("\"a\" has %d blocks, not %d", st.st_blocks, (FILE_SIZE + 511) / 512);
+  if (st.st_first_block <= st.st_ino)
+    fail ("first block of \"a\" is sector %d, before its inode at %d",
+          st.st_first_block, st.st_ino);
+  if (st.st_extents > 2)
+    fail ("blocks of \"a\" are in %d runs", st.st_extents);
+  msg ("blocks of \"a\" follow its inode");
+
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    {
+      size_t size = FILE_SIZE - ofs;
+      size_t i;
+
+      if (size > sizeof buf)
+        size = sizeof buf;
+
+      if (read (fd, buf, size) != (int) size)
+        fail ("read %zu bytes at offset %zu failed", size, ofs);
+      for (i = 0; i < size; i++)
+        if (buf[i] != 0)
+          fail ("byte %zu is %d, not 0", ofs + i, buf[i]);
+    }
+  msg ("\"a\" reads back as zeros");
+
+  CHECK (fallocate (fd, 100), "fallocate \"a\" to 100 bytes");
+  CHECK (filesize (fd) == FILE_SIZE, "filesize \"a\" is still %d", FILE_SIZE);
+
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+  CHECK ((dir_fd = open ("d")) > 1, "open \"d\"");
+  CHECK (!fallocate (dir_fd, 512), "fallocate \"d\" (must return false)");
+
+  msg ("close \"a\"");
+  close (fd);
+}
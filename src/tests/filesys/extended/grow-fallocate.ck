@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(grow-fallocate) begin
+(grow-fallocate) create "pad"
+(grow-fallocate) open "pad"
+(grow-fallocate) close "pad"
+(grow-fallocate) create "a"
+(grow-fallocate) remove "pad"
+(grow-fallocate) open "a"
+(grow-fallocate) fallocate "a" to 70000 bytes
+(grow-fallocate) filesize "a" is 70000
+(grow-fallocate) fstat "a"
+(grow-fallocate) blocks of "a" follow its inode
+(grow-fallocate) "a" reads back as zeros
+(grow-fallocate) fallocate "a" to 100 bytes
+(grow-fallocate) filesize "a" is still 70000
+(grow-fallocate) mkdir "d"
+(grow-fallocate) open "d"
+(grow-fallocate) fallocate "d" (must return false)
+(grow-fallocate) close "a"
+(grow-fallocate) end
+EOF
+pass;
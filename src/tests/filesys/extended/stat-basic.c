@@ -0,0 +1,49 @@
+/* Checks stat() and fstat() on a file and a directory, and
+   stat() on a missing file.  stat() and fstat() must agree on how
+   many handles are open. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  struct stat st, fst;
+  int fd;
+
+  CHECK (mkdir ("a"), "mkdir \"a\"");
+  CHECK (create ("a/f", 1234), "create \"a/f\"");
+
+  CHECK (stat ("a/f", &st), "stat \"a/f\"");
+  if (st.st_size != 1234 || st.st_is_dir || st.st_open_cnt != 0)
+    fail ("stat \"a/f\": size %d, is_dir %d, open_cnt %d",
+          st.st_size, st.st_is_dir, st.st_open_cnt);
+
+  CHECK ((fd = open ("a/f")) > 1, "open \"a/f\"");
+  CHECK (fstat (fd, &fst), "fstat \"a/f\"");
+  if (fst.st_ino != inumber (fd) || fst.st_ino != st.st_ino)
+    fail ("fstat inumber %d, stat inumber %d, inumber %d",
+          fst.st_ino, st.st_ino, inumber (fd));
+  if (fst.st_size != 1234 || fst.st_open_cnt != 1)
+    fail ("fstat \"a/f\": size %d, open_cnt %d",
+          fst.st_size, fst.st_open_cnt);
+  CHECK (stat ("a/f", &st) && st.st_open_cnt == 1,
+         "stat \"a/f\" counts the open handle");
+  msg ("close \"a/f\"");
+  close (fd);
+
+  CHECK (stat ("a", &st) && st.st_is_dir, "stat \"a\" is a directory");
+  if (st.st_open_cnt != 0)
+    fail ("stat \"a\": open_cnt %d", st.st_open_cnt);
+  CHECK ((fd = open ("a")) > 1, "open \"a\"");
+  CHECK (fstat (fd, &fst), "fstat \"a\"");
+  CHECK (stat ("a", &st), "stat \"a\"");
+  if (fst.st_open_cnt != 1 || st.st_open_cnt != 1)
+    fail ("fstat \"a\": open_cnt %d, stat \"a\": open_cnt %d",
+          fst.st_open_cnt, st.st_open_cnt);
+  msg ("close \"a\"");
+  close (fd);
+
+  CHECK (!stat ("a/g", &st), "stat \"a/g\" (must return false)");
+}
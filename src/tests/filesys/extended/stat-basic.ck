@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(stat-basic) begin
+(stat-basic) mkdir "a"
+(stat-basic) create "a/f"
+(stat-basic) stat "a/f"
+(stat-basic) open "a/f"
+(stat-basic) fstat "a/f"
+(stat-basic) stat "a/f" counts the open handle
+(stat-basic) close "a/f"
+(stat-basic) stat "a" is a directory
+(stat-basic) open "a"
+(stat-basic) fstat "a"
+(stat-basic) stat "a"
+(stat-basic) close "a"
+(stat-basic) stat "a/g" (must return false)
+(stat-basic) end
+EOF
+pass;
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+compare_output ("run", [grep (!/^alarm-wheel: /, @output)], [<<'EOF']);
+(alarm-wheel-1000hz) begin
+(alarm-wheel-1000hz) Creating 200 threads to sleep 8 times each.
+(alarm-wheel-1000hz) All 1600 sleeps ended on or after their deadlines.
+(alarm-wheel-1000hz) end
+EOF
+pass;
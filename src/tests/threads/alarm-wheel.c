@@ -0,0 +1,119 @@
+/* Creates many threads that each sleep several times for random
+   durations, some short enough for the near timer wheel and some
+   long enough to be cascaded down from the far one, and checks
+   that no thread ever wakes before its deadline.
+
+   Also reports, outside the checked output, how many ticks the
+   run took, as a rough benchmark of timer_sleep() under load. */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define THREAD_CNT 200          /* Number of sleeping threads. */
+#define ITERATIONS 8            /* Sleeps per thread. */
+#define MAX_SLEEP 600           /* Longest single sleep, in ticks. */
+
+/* Shared test state. */
+struct wheel_test
+  {
+    int durations[THREAD_CNT][ITERATIONS]; /* Sleep lengths. */
+    int early;                  /* # of wake-ups before deadline. */
+    int max_late;               /* Longest delay past a deadline. */
+    struct semaphore done;      /* Upped by each finishing thread. */
+  };
+
+/* A sleeper and its index. */
+struct sleeper
+  {
+    struct wheel_test *test;
+    int idx;
+  };
+
+static void sleeper (void *);
+
+void
+test_alarm_wheel (void)
+{
+  struct wheel_test *test;
+  struct sleeper *sleepers;
+  int64_t start;
+  int i, j;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  test = malloc (sizeof *test);
+  sleepers = malloc (sizeof *sleepers * THREAD_CNT);
+  if (test == NULL || sleepers == NULL)
+    PANIC ("couldn't allocate memory for test");
+
+  random_init (0);
+  for (i = 0; i < THREAD_CNT; i++)
+    for (j = 0; j < ITERATIONS; j++)
+      test->durations[i][j] = random_ulong () % MAX_SLEEP + 1;
+  test->early = 0;
+  test->max_late = 0;
+  sema_init (&test->done, 0);
+
+  msg ("Creating %d threads to sleep %d times each.",
+       THREAD_CNT, ITERATIONS);
+  start = timer_ticks ();
+  for (i = 0; i < THREAD_CNT; i++)
+    {
+      char name[16];
+
+      sleepers[i].test = test;
+      sleepers[i].idx = i;
+      snprintf (name, sizeof name, "sleeper %d", i);
+      thread_create (name, PRI_DEFAULT, sleeper, &sleepers[i]);
+    }
+  for (i = 0; i < THREAD_CNT; i++)
+    sema_down (&test->done);
+
+  printf ("alarm-wheel: %d sleeps took %"PRId64" ticks, "
+          "latest wake-up %d ticks after deadline\n",
+          THREAD_CNT * ITERATIONS, timer_ticks () - start,
+          test->max_late);
+  if (test->early != 0)
+    fail ("%d threads woke up before their deadlines", test->early);
+  msg ("All %d sleeps ended on or after their deadlines.",
+       THREAD_CNT * ITERATIONS);
+
+  free (sleepers);
+  free (test);
+}
+
+/* Sleeper thread. */
+static void
+sleeper (void *sleeper_)
+{
+  struct sleeper *s = sleeper_;
+  struct wheel_test *test = s->test;
+  int i;
+
+  for (i = 0; i < ITERATIONS; i++)
+    {
+      int64_t deadline = timer_ticks () + test->durations[s->idx][i];
+      int64_t now;
+      enum intr_level old_level;
+
+      timer_sleep (test->durations[s->idx][i]);
+      now = timer_ticks ();
+
+      old_level = intr_disable ();
+      if (now < deadline)
+        test->early++;
+      else if (now - deadline > test->max_late)
+        test->max_late = now - deadline;
+      intr_set_level (old_level);
+    }
+  sema_up (&test->done);
+}
@@ -33,11 +33,11 @@ test_mlfqs_block (void)
   
   msg ("Main thread creating block thread, sleeping 25 seconds...");
   thread_create ("block", PRI_DEFAULT, block_thread, &lock);
-  timer_sleep (25 * TIMER_FREQ);
+  timer_sleep (25 * timer_freq);
 
   msg ("Main thread spinning for 5 seconds...");
   start_time = timer_ticks ();
-  while (timer_elapsed (start_time) < 5 * TIMER_FREQ)
+  while (timer_elapsed (start_time) < 5 * timer_freq)
     continue;
 
   msg ("Main thread releasing lock.");
@@ -54,7 +54,7 @@ block_thread (void *lock_)
 
   msg ("Block thread spinning for 20 seconds...");
   start_time = timer_ticks ();
-  while (timer_elapsed (start_time) < 20 * TIMER_FREQ)
+  while (timer_elapsed (start_time) < 20 * timer_freq)
     continue;
 
   msg ("Block thread acquiring lock...");
@@ -98,7 +98,7 @@ test_mlfqs_fair (int thread_cnt, int nice_min, int nice_step)
   msg ("Starting threads took %"PRId64" ticks.", timer_elapsed (start_time));
 
   msg ("Sleeping 40 seconds to let threads run, please wait...");
-  timer_sleep (40 * TIMER_FREQ);
+  timer_sleep (40 * timer_freq);
   
   for (i = 0; i < thread_cnt; i++)
     msg ("Thread %d received %d ticks.", i, info[i].tick_count);
@@ -108,8 +108,8 @@ static void
 load_thread (void *ti_) 
 {
   struct thread_info *ti = ti_;
-  int64_t sleep_time = 5 * TIMER_FREQ;
-  int64_t spin_time = sleep_time + 30 * TIMER_FREQ;
+  int64_t sleep_time = 5 * timer_freq;
+  int64_t spin_time = sleep_time + 30 * timer_freq;
   int64_t last_time = 0;
 
   thread_set_nice (ti->nice);
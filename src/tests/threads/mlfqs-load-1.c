@@ -30,7 +30,7 @@ test_mlfqs_load_1 (void)
     {
       load_avg = thread_get_load_avg ();
       ASSERT (load_avg >= 0);
-      elapsed = timer_elapsed (start_time) / TIMER_FREQ;
+      elapsed = timer_elapsed (start_time) / timer_freq;
       if (load_avg > 100)
         fail ("load average is %d.%02d "
               "but should be between 0 and 1 (after %d seconds)",
@@ -46,7 +46,7 @@ test_mlfqs_load_1 (void)
   msg ("load average rose to 0.5 after %d seconds", elapsed);
 
   msg ("sleeping for another 10 seconds, please wait...");
-  timer_sleep (TIMER_FREQ * 10);
+  timer_sleep (timer_freq * 10);
 
   load_avg = thread_get_load_avg ();
   if (load_avg < 0)
@@ -138,12 +138,12 @@ test_mlfqs_load_avg (void)
       thread_create (name, PRI_DEFAULT, load_thread, (void *) i);
     }
   msg ("Starting threads took %d seconds.",
-       timer_elapsed (start_time) / TIMER_FREQ);
+       timer_elapsed (start_time) / timer_freq);
   thread_set_nice (-20);
 
   for (i = 0; i < 90; i++) 
     {
-      int64_t sleep_until = start_time + TIMER_FREQ * (2 * i + 10);
+      int64_t sleep_until = start_time + timer_freq * (2 * i + 10);
       int load_avg;
       timer_sleep (sleep_until - timer_ticks ());
       load_avg = thread_get_load_avg ();
@@ -156,9 +156,9 @@ static void
 load_thread (void *seq_no_) 
 {
   int seq_no = (int) seq_no_;
-  int sleep_time = TIMER_FREQ * (10 + seq_no);
-  int spin_time = sleep_time + TIMER_FREQ * THREAD_CNT;
-  int exit_time = TIMER_FREQ * (THREAD_CNT * 2);
+  int sleep_time = timer_freq * (10 + seq_no);
+  int spin_time = sleep_time + timer_freq * THREAD_CNT;
+  int exit_time = timer_freq * (THREAD_CNT * 2);
 
   timer_sleep (sleep_time - timer_elapsed (start_time));
   while (timer_elapsed (start_time) < spin_time)
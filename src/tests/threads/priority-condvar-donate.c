@@ -0,0 +1,81 @@
+/* A low-priority thread holding lock A waits on a condition
+   variable behind a medium-priority thread.  A high-priority
+   thread then blocks on A, donating its priority to the low
+   thread, which must now be signaled ahead of the medium
+   thread, since it is running at the high priority. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func low_thread_func;
+static thread_func medium_thread_func;
+static thread_func high_thread_func;
+static struct lock lock;
+static struct condition condition;
+static struct lock a;
+
+void
+test_priority_condvar_donate (void) 
+{
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_init (&lock);
+  cond_init (&condition);
+  lock_init (&a);
+
+  thread_create ("low", PRI_DEFAULT + 1, low_thread_func, NULL);
+  thread_create ("medium", PRI_DEFAULT + 3, medium_thread_func, NULL);
+  thread_create ("high", PRI_DEFAULT + 5, high_thread_func, NULL);
+
+  lock_acquire (&lock);
+  msg ("Main signaling.");
+  cond_signal (&condition, &lock);
+  lock_release (&lock);
+
+  lock_acquire (&lock);
+  msg ("Main signaling.");
+  cond_signal (&condition, &lock);
+  lock_release (&lock);
+
+  msg ("Main finished.");
+}
+
+static void
+low_thread_func (void *aux UNUSED) 
+{
+  lock_acquire (&a);
+  lock_acquire (&lock);
+  msg ("Thread low waiting.");
+  cond_wait (&condition, &lock);
+  msg ("Thread low woke up with priority %d.", thread_get_priority ());
+  lock_release (&lock);
+  lock_release (&a);
+  msg ("Thread low finished.");
+}
+
+static void
+medium_thread_func (void *aux UNUSED) 
+{
+  lock_acquire (&lock);
+  msg ("Thread medium waiting.");
+  cond_wait (&condition, &lock);
+  msg ("Thread medium woke up.");
+  lock_release (&lock);
+  msg ("Thread medium finished.");
+}
+
+static void
+high_thread_func (void *aux UNUSED) 
+{
+  lock_acquire (&a);
+  msg ("Thread high got lock a.");
+  lock_release (&a);
+  msg ("Thread high finished.");
+}
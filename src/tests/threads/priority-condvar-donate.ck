@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-condvar-donate) begin
+(priority-condvar-donate) Thread low waiting.
+(priority-condvar-donate) Thread medium waiting.
+(priority-condvar-donate) Main signaling.
+(priority-condvar-donate) Thread low woke up with priority 36.
+(priority-condvar-donate) Thread high got lock a.
+(priority-condvar-donate) Thread high finished.
+(priority-condvar-donate) Thread low finished.
+(priority-condvar-donate) Main signaling.
+(priority-condvar-donate) Thread medium woke up.
+(priority-condvar-donate) Thread medium finished.
+(priority-condvar-donate) Main finished.
+(priority-condvar-donate) end
+EOF
+pass;
@@ -0,0 +1,71 @@
+/* The main thread acquires eight locks, then creates a
+   higher-priority thread to wait on each of them, in no
+   particular order of priority.  As it releases the locks one
+   by one, its priority must drop to the highest donation it
+   still receives, however many other locks it holds. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+#define LOCK_CNT 8
+
+static thread_func donor_thread_func;
+
+void
+test_priority_donate_many (void) 
+{
+  static const int boost[LOCK_CNT] = {3, 7, 1, 5, 8, 2, 6, 4};
+  struct lock locks[LOCK_CNT];
+  int max_boost;
+  int i, j;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  for (i = 0; i < LOCK_CNT; i++)
+    {
+      lock_init (&locks[i]);
+      lock_acquire (&locks[i]);
+    }
+
+  max_boost = 0;
+  for (i = 0; i < LOCK_CNT; i++)
+    {
+      char name[16];
+
+      snprintf (name, sizeof name, "donor %d", i);
+      thread_create (name, PRI_DEFAULT + boost[i], donor_thread_func,
+                     &locks[i]);
+      if (boost[i] > max_boost)
+        max_boost = boost[i];
+      msg ("Main thread should have priority %d.  Actual priority: %d.",
+           PRI_DEFAULT + max_boost, thread_get_priority ());
+    }
+
+  for (i = 0; i < LOCK_CNT; i++)
+    {
+      lock_release (&locks[i]);
+      max_boost = 0;
+      for (j = i + 1; j < LOCK_CNT; j++)
+        if (boost[j] > max_boost)
+          max_boost = boost[j];
+      msg ("Released lock %d.  Main thread should have priority %d.  "
+           "Actual priority: %d.",
+           i, PRI_DEFAULT + max_boost, thread_get_priority ());
+    }
+}
+
+static void
+donor_thread_func (void *lock_) 
+{
+  struct lock *lock = lock_;
+
+  lock_acquire (lock);
+  lock_release (lock);
+}
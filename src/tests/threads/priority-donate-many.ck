@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(priority-donate-many) begin
+(priority-donate-many) Main thread should have priority 34.  Actual priority: 34.
+(priority-donate-many) Main thread should have priority 38.  Actual priority: 38.
+(priority-donate-many) Main thread should have priority 38.  Actual priority: 38.
+(priority-donate-many) Main thread should have priority 38.  Actual priority: 38.
+(priority-donate-many) Main thread should have priority 39.  Actual priority: 39.
+(priority-donate-many) Main thread should have priority 39.  Actual priority: 39.
+(priority-donate-many) Main thread should have priority 39.  Actual priority: 39.
+(priority-donate-many) Main thread should have priority 39.  Actual priority: 39.
+(priority-donate-many) Released lock 0.  Main thread should have priority 39.  Actual priority: 39.
+(priority-donate-many) Released lock 1.  Main thread should have priority 39.  Actual priority: 39.
+(priority-donate-many) Released lock 2.  Main thread should have priority 39.  Actual priority: 39.
+(priority-donate-many) Released lock 3.  Main thread should have priority 39.  Actual priority: 39.
+(priority-donate-many) Released lock 4.  Main thread should have priority 37.  Actual priority: 37.
+(priority-donate-many) Released lock 5.  Main thread should have priority 37.  Actual priority: 37.
+(priority-donate-many) Released lock 6.  Main thread should have priority 35.  Actual priority: 35.
+(priority-donate-many) Released lock 7.  Main thread should have priority 31.  Actual priority: 31.
+(priority-donate-many) end
+EOF
+pass;
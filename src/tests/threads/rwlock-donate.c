@@ -0,0 +1,55 @@
+/* The main thread holds a readers-writer lock for reading while
+   a higher-priority writer waits for it.  The writer must donate
+   its priority to the main thread, so that a thread of middling
+   priority created next does not run ahead of the main thread
+   and, through it, of the writer. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread_func;
+static thread_func hog_thread_func;
+
+void
+test_rwlock_donate (void) 
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  rwlock_acquire_read (&rw);
+  thread_create ("writer", PRI_DEFAULT + 2, writer_thread_func, &rw);
+  msg ("This thread should have priority %d.  Actual priority: %d.",
+       PRI_DEFAULT + 2, thread_get_priority ());
+  thread_create ("hog", PRI_DEFAULT + 1, hog_thread_func, NULL);
+
+  msg ("Main thread releasing the lock.");
+  rwlock_release_read (&rw);
+  msg ("Main thread finished.");
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  msg ("Writer acquiring the lock.");
+  rwlock_acquire_write (rw);
+  msg ("Writer acquired the lock.");
+  rwlock_release_write (rw);
+  msg ("Writer finished.");
+}
+
+static void
+hog_thread_func (void *aux UNUSED) 
+{
+  msg ("Hog running.");
+}
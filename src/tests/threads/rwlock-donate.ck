@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-donate) begin
+(rwlock-donate) Writer acquiring the lock.
+(rwlock-donate) This thread should have priority 33.  Actual priority: 33.
+(rwlock-donate) Main thread releasing the lock.
+(rwlock-donate) Writer acquired the lock.
+(rwlock-donate) Writer finished.
+(rwlock-donate) Hog running.
+(rwlock-donate) Main thread finished.
+(rwlock-donate) end
+EOF
+pass;
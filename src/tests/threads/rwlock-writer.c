@@ -0,0 +1,66 @@
+/* The main thread holds a readers-writer lock for reading while
+   a higher-priority writer and then an even higher-priority
+   reader try to acquire it.  The reader must queue behind the
+   waiting writer rather than join the main thread, and must
+   donate its priority to the writer, so that once the main
+   thread lets go the writer runs first.  Meanwhile the main
+   thread, which already reads the lock, may read it again
+   without waiting behind the writer. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+static thread_func writer_thread_func;
+static thread_func reader_thread_func;
+
+void
+test_rwlock_writer (void) 
+{
+  struct rwlock rw;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  rwlock_init (&rw);
+  rwlock_acquire_read (&rw);
+  thread_create ("writer", PRI_DEFAULT + 1, writer_thread_func, &rw);
+  thread_create ("reader", PRI_DEFAULT + 2, reader_thread_func, &rw);
+
+  rwlock_acquire_read (&rw);
+  msg ("Main thread read the lock again.");
+  rwlock_release_read (&rw);
+
+  msg ("Main thread releasing the lock.");
+  rwlock_release_read (&rw);
+  msg ("Main thread finished.");
+}
+
+static void
+writer_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  msg ("Writer acquiring the lock.");
+  rwlock_acquire_write (rw);
+  msg ("Writer acquired the lock with priority %d.", thread_get_priority ());
+  rwlock_release_write (rw);
+  msg ("Writer finished.");
+}
+
+static void
+reader_thread_func (void *rw_) 
+{
+  struct rwlock *rw = rw_;
+
+  msg ("Reader acquiring the lock.");
+  rwlock_acquire_read (rw);
+  msg ("Reader acquired the lock.");
+  rwlock_release_read (rw);
+  msg ("Reader finished.");
+}
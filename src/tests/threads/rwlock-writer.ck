@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(rwlock-writer) begin
+(rwlock-writer) Writer acquiring the lock.
+(rwlock-writer) Reader acquiring the lock.
+(rwlock-writer) Main thread read the lock again.
+(rwlock-writer) Main thread releasing the lock.
+(rwlock-writer) Writer acquired the lock with priority 33.
+(rwlock-writer) Reader acquired the lock.
+(rwlock-writer) Reader finished.
+(rwlock-writer) Writer finished.
+(rwlock-writer) Main thread finished.
+(rwlock-writer) end
+EOF
+pass;
@@ -17,6 +17,10 @@ static const struct test tests[] =
     {"alarm-priority", test_alarm_priority},
     {"alarm-zero", test_alarm_zero},
     {"alarm-negative", test_alarm_negative},
+    {"alarm-wheel", test_alarm_wheel},
+    {"alarm-multiple-19hz", test_alarm_multiple},
+    {"alarm-multiple-1000hz", test_alarm_multiple},
+    {"alarm-wheel-1000hz", test_alarm_wheel},
     {"priority-change", test_priority_change},
     {"priority-donate-one", test_priority_donate_one},
     {"priority-donate-multiple", test_priority_donate_multiple},
@@ -25,10 +29,14 @@ static const struct test tests[] =
     {"priority-donate-sema", test_priority_donate_sema},
     {"priority-donate-lower", test_priority_donate_lower},
     {"priority-donate-chain", test_priority_donate_chain},
+    {"priority-donate-many", test_priority_donate_many},
     {"priority-fifo", test_priority_fifo},
     {"priority-preempt", test_priority_preempt},
     {"priority-sema", test_priority_sema},
     {"priority-condvar", test_priority_condvar},
+    {"priority-condvar-donate", test_priority_condvar_donate},
+    {"rwlock-writer", test_rwlock_writer},
+    {"rwlock-donate", test_rwlock_donate},
     {"mlfqs-load-1", test_mlfqs_load_1},
     {"mlfqs-load-60", test_mlfqs_load_60},
     {"mlfqs-load-avg", test_mlfqs_load_avg},
@@ -38,6 +46,8 @@ static const struct test tests[] =
     {"mlfqs-nice-2", test_mlfqs_nice_2},
     {"mlfqs-nice-10", test_mlfqs_nice_10},
     {"mlfqs-block", test_mlfqs_block},
+    {"mlfqs-load-1-1000hz", test_mlfqs_load_1},
+    {"mlfqs-load-avg-1000hz", test_mlfqs_load_avg},
   };
 
 static const char *test_name;
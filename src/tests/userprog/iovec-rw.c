@@ -0,0 +1,39 @@
+/* Writes a file from several buffers with writev(), including an
+   empty one, and reads it back into differently split buffers
+   with readv(). */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t size = sizeof sample - 1;
+  char buf[sizeof sample];
+  struct iovec iov[3];
+  int fd;
+
+  CHECK (create ("test.txt", 0), "create \"test.txt\"");
+  CHECK ((fd = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  iov[0].iov_base = sample;
+  iov[0].iov_len = 10;
+  iov[1].iov_base = sample + 10;
+  iov[1].iov_len = 0;
+  iov[2].iov_base = sample + 10;
+  iov[2].iov_len = size - 10;
+  CHECK (writev (fd, iov, 3) == (int) size, "writev \"test.txt\"");
+
+  seek (fd, 0);
+  iov[0].iov_base = buf;
+  iov[0].iov_len = 100;
+  iov[1].iov_base = buf + 100;
+  iov[1].iov_len = sizeof buf - 100;
+  CHECK (readv (fd, iov, 2) == (int) size, "readv \"test.txt\"");
+  compare_bytes (buf, sample, size, 0, "test.txt");
+
+  msg ("close \"test.txt\"");
+  close (fd);
+}
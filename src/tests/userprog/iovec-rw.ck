@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(iovec-rw) begin
+(iovec-rw) create "test.txt"
+(iovec-rw) open "test.txt"
+(iovec-rw) writev "test.txt"
+(iovec-rw) readv "test.txt"
+(iovec-rw) close "test.txt"
+(iovec-rw) end
+iovec-rw: exit(0)
+EOF
+pass;
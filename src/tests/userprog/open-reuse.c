@@ -0,0 +1,32 @@
+/* Opens a file several times, closes one of the handles in the
+   middle, and checks that the next open() reuses the lowest free
+   file descriptor. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define HANDLE_CNT 40
+
+void
+test_main (void)
+{
+  int fds[HANDLE_CNT];
+  int i, fd;
+
+  for (i = 0; i < HANDLE_CNT; i++)
+    if ((fds[i] = open ("sample.txt")) < 2)
+      fail ("open #%d failed", i);
+  msg ("opened \"sample.txt\" %d times", HANDLE_CNT);
+
+  for (i = 1; i < HANDLE_CNT; i++)
+    if (fds[i] <= fds[i - 1])
+      fail ("fd %d follows fd %d", fds[i], fds[i - 1]);
+
+  close (fds[5]);
+  close (fds[20]);
+  CHECK ((fd = open ("sample.txt")) == fds[5], "reopen reuses first closed fd");
+  CHECK ((fd = open ("sample.txt")) == fds[20], "reopen reuses second closed fd");
+  CHECK ((fd = open ("sample.txt")) > fds[HANDLE_CNT - 1],
+         "next open gets a fresh fd");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(open-reuse) begin
+(open-reuse) opened "sample.txt" 40 times
+(open-reuse) reopen reuses first closed fd
+(open-reuse) reopen reuses second closed fd
+(open-reuse) next open gets a fresh fd
+(open-reuse) end
+open-reuse: exit(0)
+EOF
+pass;
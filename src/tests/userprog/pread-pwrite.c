@@ -0,0 +1,39 @@
+/* Writes a file out of order with pwrite() and reads pieces of it
+   back with pread(), checking that neither call moves the file
+   position. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  size_t size = sizeof sample - 1;
+  char buf[sizeof sample];
+  int fd;
+
+  CHECK (create ("test.txt", 0), "create \"test.txt\"");
+  CHECK ((fd = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  CHECK (pwrite (fd, sample + 100, size - 100, 100) == (int) (size - 100),
+         "pwrite tail of \"test.txt\"");
+  CHECK (pwrite (fd, sample, 100, 0) == 100, "pwrite head of \"test.txt\"");
+  CHECK (tell (fd) == 0, "tell \"test.txt\" after pwrite");
+
+  CHECK (pread (fd, buf, 50, 150) == 50, "pread middle of \"test.txt\"");
+  compare_bytes (buf, sample + 150, 50, 150, "test.txt");
+  CHECK (pread (fd, buf, sizeof buf, 0) == (int) size,
+         "pread all of \"test.txt\"");
+  compare_bytes (buf, sample, size, 0, "test.txt");
+  CHECK (tell (fd) == 0, "tell \"test.txt\" after pread");
+
+  CHECK (pread (fd, buf, 10, 0x80000000u) == -1,
+         "pread past INT_MAX fails");
+  CHECK (pwrite (fd, sample, 10, 0x7ffffffau) == -1,
+         "pwrite across INT_MAX fails");
+
+  msg ("close \"test.txt\"");
+  close (fd);
+}
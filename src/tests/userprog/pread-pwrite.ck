@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) create "test.txt"
+(pread-pwrite) open "test.txt"
+(pread-pwrite) pwrite tail of "test.txt"
+(pread-pwrite) pwrite head of "test.txt"
+(pread-pwrite) tell "test.txt" after pwrite
+(pread-pwrite) pread middle of "test.txt"
+(pread-pwrite) pread all of "test.txt"
+(pread-pwrite) tell "test.txt" after pread
+(pread-pwrite) pread past INT_MAX fails
+(pread-pwrite) pwrite across INT_MAX fails
+(pread-pwrite) close "test.txt"
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
@@ -0,0 +1,36 @@
+/* Maps a file, closes its handle, then opens and maps it again,
+   so that the second open reuses the first file descriptor.
+   The two mappings must still get different ids, and unmapping
+   the first must leave the second intact. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL1 ((void *) 0x10000000)
+#define ACTUAL2 ((void *) 0x20000000)
+
+void
+test_main (void)
+{
+  int handle1, handle2;
+  mapid_t map1, map2;
+
+  CHECK ((handle1 = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map1 = mmap (handle1, ACTUAL1)) != MAP_FAILED,
+         "mmap \"sample.txt\"");
+  close (handle1);
+
+  CHECK ((handle2 = open ("sample.txt")) > 1, "reopen \"sample.txt\"");
+  CHECK ((map2 = mmap (handle2, ACTUAL2)) != MAP_FAILED,
+         "mmap \"sample.txt\" again");
+  close (handle2);
+  CHECK (map1 != map2, "mapping ids differ");
+
+  munmap (map1);
+  if (memcmp (ACTUAL2, sample, strlen (sample)))
+    fail ("second mapping damaged by munmap of the first");
+  munmap (map2);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-reuse) begin
+(mmap-reuse) open "sample.txt"
+(mmap-reuse) mmap "sample.txt"
+(mmap-reuse) reopen "sample.txt"
+(mmap-reuse) mmap "sample.txt" again
+(mmap-reuse) mapping ids differ
+(mmap-reuse) end
+EOF
+pass;
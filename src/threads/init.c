@@ -266,6 +266,25 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-lp"))
+        lock_profiling = true;
+      else if (!strcmp (name, "-tf"))
+        {
+          timer_freq = atoi (value);
+          if (timer_freq < TIMER_FREQ_MIN || timer_freq > TIMER_FREQ_MAX)
+            PANIC ("timer frequency must be between %d and %d Hz",
+                   TIMER_FREQ_MIN, TIMER_FREQ_MAX);
+        }
+      else if (!strcmp (name, "-ts"))
+        {
+          char *low = strchr (value, ',');
+
+          thread_slice_high = thread_slice_low = atoi (value);
+          if (low != NULL)
+            thread_slice_low = atoi (low + 1);
+          if (thread_slice_high < 1 || thread_slice_low < 1)
+            PANIC ("time slices must be at least one tick");
+        }
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -389,6 +408,10 @@ usage (void)
 #endif
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -lp                Profile lock contention, print at shutdown.\n"
+          "  -tf=HZ             Interrupt HZ times a second (19 to 1000).\n"
+          "  -ts=HIGH[,LOW]     Give HIGH-tick time slices at PRI_MAX,\n"
+          "                     scaling to LOW ticks at PRI_MIN.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
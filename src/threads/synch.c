@@ -27,11 +27,63 @@
 */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
+#include "devices/timer.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* Maximum length of a priority donation chain. */
+#define DONATION_DEPTH 8
+
+/* Rounds lock_acquire_adaptive() polls a running holder. */
+#define SPIN_LIMIT 100
+
+static void take_lock (struct lock *, struct thread *);
+static void donate_priority (struct thread *);
+static void donate_to (struct lock *, int priority, int depth);
+static void donate_to_readers (struct rwlock *, int priority, int depth);
+static void lock_acquire_at (struct lock *, const void *site);
+static void lock_acquire_adaptive (struct lock *, const void *site);
+
+/* Lock contention statistics.  Locks are grouped by the name
+   given to lock_init_named(), or else by the place that called
+   lock_init() or rwlock_init() on them, so that, for example,
+   every inode's lock shares one record.  Records are never
+   freed. */
+struct lock_profile
+  {
+    const char *name;           /* Name given to lock_init_named(). */
+    const void *init_site;      /* Otherwise, caller of lock_init(). */
+    unsigned acquires;          /* # of acquisitions. */
+    unsigned contended;         /* # of acquisitions that had to wait. */
+    int64_t wait_ticks;         /* Total ticks spent waiting. */
+    int64_t max_wait;           /* Longest single wait, in ticks. */
+    const void *max_wait_site;  /* Caller of lock_acquire() that waited
+                                   longest. */
+    int64_t max_hold;           /* Longest time held, in ticks. */
+  };
+
+#define LOCK_PROFILE_CNT 128
+static struct lock_profile lock_profiles[LOCK_PROFILE_CNT];
+static int lock_profile_cnt;
+bool lock_profiling;
+
+static void lock_init_profiled (struct lock *, const char *name,
+                                const void *init_site);
+static struct lock_profile *lock_profile_find (const char *name,
+                                               const void *init_site);
+static void lock_profile_acquired (struct lock *, bool contended,
+                                   int64_t start, const void *site);
+static void lock_profile_released (struct lock *);
+static bool less_lock (const struct list_elem *, const struct list_elem *,
+                       void *aux);
+static void insert_ordered_back (struct list *, struct list_elem *,
+                                 list_less_func *, void *aux);
+static bool higher_priority (const struct list_elem *,
+                             const struct list_elem *, void *aux);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -67,9 +119,13 @@ sema_down (struct semaphore *sema)
   old_level = intr_disable ();
   while (sema->value == 0) 
     {
-      list_insert_ordered(&sema->waiters,&thread_current()->elem,less_priority,NULL);
-      // list_push_back (&sema->waiters, &thread_current ()->elem);
+      struct thread *cur = thread_current ();
+
+      insert_ordered_back (&sema->waiters, &cur->elem,
+                           higher_priority, NULL);
+      cur->waiting_sema = sema;
       thread_block ();
+      cur->waiting_sema = NULL;
     }
   sema->value--;
   intr_set_level (old_level);
@@ -112,7 +168,6 @@ sema_up (struct semaphore *sema)
   ASSERT (sema != NULL);
   old_level = intr_disable ();
   sema->value++; //origin position : next line
-  list_sort(&sema->waiters,less_priority,NULL);
   if (!list_empty (&sema->waiters)){ 
     thread_unblock (list_entry (list_pop_front (&sema->waiters),
                                 struct thread, elem));
@@ -120,6 +175,48 @@ sema_up (struct semaphore *sema)
   intr_set_level (old_level);
 }
 
+/* Moves T, which is blocked waiting for SEMA, to its place among
+   SEMA's waiters for the priority it now has.  Called when T's
+   priority changes while it waits.  Interrupts must be off. */
+void
+sema_requeue (struct semaphore *sema, struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->waiting_sema == sema);
+
+  list_remove (&t->elem);
+  insert_ordered_back (&sema->waiters, &t->elem, higher_priority, NULL);
+}
+
+/* Inserts ELEM into LIST, which must be sorted according to LESS
+   given auxiliary data AUX, after any elements it does not sort
+   before.  Like list_insert_ordered(), but searches from the back
+   of the list: waiters usually share a priority, and in a convoy
+   of threads at PRI_DEFAULT this makes insertion take constant
+   time, just as waking the first waiter always does. */
+static void
+insert_ordered_back (struct list *list, struct list_elem *elem,
+                     list_less_func *less, void *aux)
+{
+  struct list_elem *e;
+
+  for (e = list_rbegin (list); e != list_rend (list); e = list_prev (e))
+    if (!less (elem, e, aux))
+      break;
+  list_insert (list_next (e), elem);
+}
+
+/* Orders threads by descending priority. */
+static bool
+higher_priority (const struct list_elem *a_, const struct list_elem *b_,
+                 void *aux UNUSED)
+{
+  const struct thread *a = list_entry (a_, struct thread, elem);
+  const struct thread *b = list_entry (b_, struct thread, elem);
+
+  return a->priority > b->priority;
+}
+
 static void sema_test_helper (void *sema_);
 
 /* Self-test for semaphores that makes control "ping-pong"
@@ -174,11 +271,38 @@ sema_test_helper (void *sema_)
    instead of a lock. */
 void
 lock_init (struct lock *lock)
+{
+  lock_init_profiled (lock, NULL, __builtin_return_address (0));
+}
+
+/* Initializes LOCK like lock_init(), but under "-lp" gathers its
+   statistics in the record for NAME, shared with every other
+   lock given the same name, instead of by call site.  Useful
+   when one call site initializes locks that are worth telling
+   apart.  NAME must stay valid for as long as the kernel runs. */
+void
+lock_init_named (struct lock *lock, const char *name)
+{
+  ASSERT (name != NULL);
+
+  lock_init_profiled (lock, name, NULL);
+}
+
+/* Initializes LOCK, profiling it, if profiling is enabled, in the
+   record for NAME if it is nonnull, otherwise in the record for
+   locks initialized at INIT_SITE. */
+static void
+lock_init_profiled (struct lock *lock, const char *name,
+                    const void *init_site)
 {
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
   sema_init (&lock->semaphore, 1);
+  lock->max_priority = PRI_MIN - 1;
+  lock->profile = (lock_profiling
+                   ? lock_profile_find (name, init_site)
+                   : NULL);
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -192,34 +316,124 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  lock_acquire_at (lock, __builtin_return_address (0));
+}
+
+/* Acquires LOCK like lock_acquire(), crediting any time spent
+   waiting to SITE in LOCK's profile. */
+static void
+lock_acquire_at (struct lock *lock, const void *site)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int64_t start = 0;
+  bool contended;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
-if(!lock->semaphore.value){
-  thread_current()->waiting_lock=lock;
-  acquire_sync(lock, thread_current());
-}
+  old_level = intr_disable ();
+  contended = lock->holder != NULL;
+  if (lock->profile != NULL)
+    start = timer_ticks ();
+  if (contended && !thread_mlfqs)
+    {
+      cur->waiting_lock = lock;
+      donate_priority (cur);
+    }
   sema_down (&lock->semaphore);
-  
-  lock->holder = thread_current ();
-  list_push_back(&thread_current()->lock_list,&lock->elem);
-  // list_insert_ordered(&lock->holder->lock_list,&lock->elem,less_lock,NULL);
-  
+  cur->waiting_lock = NULL;
+  take_lock (lock, cur);
+  if (lock->profile != NULL)
+    lock_profile_acquired (lock, contended, start, site);
+  intr_set_level (old_level);
 }
 
-void 
-acquire_sync(struct lock *lock, struct thread *t)
+/* Makes T, which has just downed LOCK's semaphore, LOCK's
+   holder.  Interrupts must be off. */
+static void
+take_lock (struct lock *lock, struct thread *t)
+{
+  struct list *waiters = &lock->semaphore.waiters;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  lock->holder = t;
+  lock->max_priority = (list_empty (waiters) ? PRI_MIN - 1
+                        : list_entry (list_front (waiters),
+                                      struct thread, elem)->priority);
+  list_insert_ordered (&t->lock_list, &lock->elem, less_lock, NULL);
+  if (!thread_mlfqs && lock->max_priority > t->priority)
+    thread_change_priority (t, lock->max_priority);
+}
+
+/* Donates the priority of T, which is about to wait for
+   T->waiting_lock, down the chain of lock holders that T
+   transitively waits for.  Interrupts must be off. */
+static void
+donate_priority (struct thread *t)
+{
+  donate_to (t->waiting_lock, t->priority, 0);
+}
+
+/* Donates PRIORITY to the holder of LOCK and on down the chain of
+   holders that it transitively waits for, DEPTH links into the
+   chain already.  A holder that is a writer waiting for an
+   rwlock's readers passes the donation on to every one of them.
+   Each lock's max_priority and each holder's priority is raised
+   only if PRIORITY is higher, so the walk stops at the first
+   link that already has it, and in any case after DONATION_DEPTH
+   links.  Interrupts must be off. */
+static void
+donate_to (struct lock *lock, int priority, int depth)
 {
-  bool donate = false;
-  if(lock->holder->priority < t->priority){
-      lock->holder->priority = t->priority;
-      donate = true;
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (; lock != NULL && depth < DONATION_DEPTH; depth++)
+    {
+      struct thread *holder = lock->holder;
+
+      if (lock->max_priority >= priority)
+        break;
+      lock->max_priority = priority;
+      if (holder == NULL)
+        break;
+
+      /* Keep the holder's locks ordered by max_priority. */
+      list_remove (&lock->elem);
+      list_insert_ordered (&holder->lock_list, &lock->elem, less_lock, NULL);
+
+      if (holder->priority >= priority)
+        break;
+      thread_change_priority (holder, priority);   /* Also requeues. */
+
+      /* If the holder is blocked waiting for a lock, or for
+         readers to leave, in turn, carry on down the chain.  (A
+         holder that has been woken but has not yet run is ready,
+         not waiting.) */
+      if (holder->status != THREAD_BLOCKED)
+        break;
+      lock = holder->waiting_lock;
+      if (lock == NULL && holder->waiting_rw != NULL)
+        donate_to_readers (holder->waiting_rw, priority, depth + 1);
     }
-  if(lock->holder->waiting_lock != NULL && (donate)){
-    acquire_sync(lock->holder->waiting_lock, lock->holder);
-  }
 }
+
+/* Donates PRIORITY to every thread that holds RW for reading,
+   DEPTH links into a donation chain.  Interrupts must be off. */
+static void
+donate_to_readers (struct rwlock *rw, int priority, int depth)
+{
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (e = list_begin (&rw->holds); e != list_end (&rw->holds);
+       e = list_next (e))
+    donate_to (&list_entry (e, struct rw_hold, elem)->lock, priority, depth);
+}
+
 /* Tries to acquires LOCK and returns true if successful or false
    on failure.  The lock must not already be held by the current
    thread.
@@ -229,57 +443,187 @@ acquire_sync(struct lock *lock, struct thread *t)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      take_lock (lock, thread_current ());
+      if (lock->profile != NULL)
+        lock_profile_acquired (lock, false, 0, __builtin_return_address (0));
+    }
+  intr_set_level (old_level);
   return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
 
+   The current thread's priority drops back to the larger of its
+   own priority and the highest donation it still receives, which
+   is the max_priority of the first lock left in its lock_list.
+
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
    handler. */
 void
 lock_release (struct lock *lock) 
 {
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
-  list_remove(&lock->elem);
-  release_sync(lock->holder);
-  if(!list_empty(&lock->semaphore.waiters)){
-    lock->holder = list_entry(list_front(&lock->semaphore.waiters), struct thread, elem);
-  }
-  else{
-    lock->holder = NULL;
-  }
+
+  old_level = intr_disable ();
+  if (lock->profile != NULL)
+    lock_profile_released (lock);
+  list_remove (&lock->elem);
+  lock->holder = NULL;
+  if (!thread_mlfqs)
+    {
+      int priority = cur->real_priority;
+
+      if (!list_empty (&cur->lock_list))
+        {
+          struct lock *next = list_entry (list_front (&cur->lock_list),
+                                          struct lock, elem);
+          if (next->max_priority > priority)
+            priority = next->max_priority;
+        }
+      cur->priority = priority;
+    }
   sema_up (&lock->semaphore);
+  intr_set_level (old_level);
 }
 
-void
-release_sync(struct thread *t){
-  struct list *holding_locks = &t->lock_list;
-  struct list_elem *e;
-  struct lock *target_lock;
-  int max_priority = t->real_priority;
-
-  if(!list_empty(holding_locks)){
-    for(e=list_front(holding_locks);e!=list_end(holding_locks);e=list_next(e)){
-      target_lock = list_entry(e,struct lock,elem);
-      if(!list_empty(&target_lock->semaphore.waiters)){
-        if(max_priority<list_entry(list_front(&target_lock->semaphore.waiters),struct thread, elem)->priority){
-          max_priority = list_entry(list_front(&target_lock->semaphore.waiters),struct thread, elem)->priority;
-        }
+/* Returns the profile record for locks named NAME, or for
+   unnamed locks initialized at INIT_SITE if NAME is null,
+   creating it if necessary, or a null pointer if the table is
+   full. */
+static struct lock_profile *
+lock_profile_find (const char *name, const void *init_site)
+{
+  struct lock_profile *p = NULL;
+  enum intr_level old_level;
+  int i;
+
+  old_level = intr_disable ();
+  for (i = 0; i < lock_profile_cnt; i++)
+    if (name != NULL
+        ? (lock_profiles[i].name != NULL
+           && !strcmp (lock_profiles[i].name, name))
+        : (lock_profiles[i].name == NULL
+           && lock_profiles[i].init_site == init_site))
+      {
+        p = &lock_profiles[i];
+        break;
       }
+  if (p == NULL && lock_profile_cnt < LOCK_PROFILE_CNT)
+    {
+      p = &lock_profiles[lock_profile_cnt++];
+      p->name = name;
+      p->init_site = init_site;
     }
-  }
-  t->priority = max_priority;
+  intr_set_level (old_level);
+  return p;
+}
 
+/* Records that LOCK has just been acquired on behalf of the
+   caller at SITE, which started waiting at tick START if
+   CONTENDED.  Interrupts must be off. */
+static void
+lock_profile_acquired (struct lock *lock, bool contended, int64_t start,
+                       const void *site)
+{
+  struct lock_profile *p = lock->profile;
+  int64_t now = timer_ticks ();
+
+  p->acquires++;
+  if (contended)
+    {
+      int64_t wait = now - start;
+
+      p->contended++;
+      p->wait_ticks += wait;
+      if (p->max_wait_site == NULL || wait > p->max_wait)
+        {
+          p->max_wait = wait;
+          p->max_wait_site = site;
+        }
+    }
+  lock->acquired = now;
+}
+
+/* Records that LOCK is about to be released.  Interrupts must be
+   off. */
+static void
+lock_profile_released (struct lock *lock)
+{
+  struct lock_profile *p = lock->profile;
+  int64_t hold = timer_ticks () - lock->acquired;
+
+  if (hold > p->max_hold)
+    p->max_hold = hold;
+}
+
+/* Prints lock contention statistics, most contended locks first,
+   if they were gathered.  Locks are identified by name or by the
+   address of their lock_init() call site; pass the addresses to
+   the `backtrace' utility to turn them into function names. */
+void
+lock_print_stats (void)
+{
+  int order[LOCK_PROFILE_CNT];
+  int i, j;
+
+  if (!lock_profiling)
+    return;
+
+  /* Insertion sort by contended acquisitions. */
+  for (i = 0; i < lock_profile_cnt; i++)
+    {
+      for (j = i; j > 0 && (lock_profiles[order[j - 1]].contended
+                            < lock_profiles[i].contended); j--)
+        order[j] = order[j - 1];
+      order[j] = i;
+    }
+
+  printf ("Lock profile (name or lock_init() caller: acquisitions, "
+          "contended, ticks waiting, longest hold):\n");
+  for (i = 0; i < lock_profile_cnt; i++)
+    {
+      struct lock_profile *p = &lock_profiles[order[i]];
+
+      if (p->acquires == 0)
+        continue;
+      if (p->name != NULL)
+        printf ("  %s", p->name);
+      else
+        printf ("  %p", p->init_site);
+      printf (": %u, %u, %"PRId64", %"PRId64,
+              p->acquires, p->contended, p->wait_ticks,
+              p->max_hold);
+      if (p->contended > 0)
+        printf ("; longest wait %"PRId64" ticks at %p",
+                p->max_wait, p->max_wait_site);
+      printf ("\n");
+    }
+}
+
+/* Orders locks by descending max_priority. */
+static bool
+less_lock (const struct list_elem *a_, const struct list_elem *b_,
+           void *aux UNUSED)
+{
+  const struct lock *a = list_entry (a_, struct lock, elem);
+  const struct lock *b = list_entry (b_, struct lock, elem);
+
+  return a->max_priority > b->max_priority;
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -297,8 +641,12 @@ struct semaphore_elem
   {
     struct list_elem elem;              /* List element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on it. */
   };
 
+static bool higher_waiter (const struct list_elem *, const struct list_elem *,
+                           void *aux);
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -329,11 +677,16 @@ cond_init (struct condition *cond)
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
-   we need to sleep. */
+   we need to sleep.
+
+   COND's waiters are kept in priority order.  A waiter can
+   receive a donation from a thread that does not hold LOCK, so
+   the list is only changed with interrupts off. */
 void
 cond_wait (struct condition *cond, struct lock *lock) 
 {
   struct semaphore_elem waiter;
+  enum intr_level old_level;
 
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
@@ -341,14 +694,11 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
-  struct thread *curr = thread_current();
-  list_insert_ordered(&cond->waiters,&waiter.elem,less_sema,curr);
-  // if(list_empty(list_entry(&waiter.elem,struct semaphore_elem, elem)->semaphore.waiters)){
-  //   list_push_back(&cond->waiters,&waiter.elem);
-  // }
-  // else{
-  //   list_insert_ordered(&cond->waiters,&waiter.elem,less_sema,NULL);
-  // }
+  waiter.thread = thread_current ();
+  old_level = intr_disable ();
+  insert_ordered_back (&cond->waiters, &waiter.elem, higher_waiter, NULL);
+  waiter.thread->waiting_cond = cond;
+  intr_set_level (old_level);
 
   lock_release (lock);
   sema_down (&waiter.semaphore);
@@ -365,15 +715,23 @@ cond_wait (struct condition *cond, struct lock *lock)
 void
 cond_signal (struct condition *cond, struct lock *lock UNUSED) 
 {
+  enum intr_level old_level;
+
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
 
-  if (!list_empty (&cond->waiters)){
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
-  }
+  old_level = intr_disable ();
+  if (!list_empty (&cond->waiters))
+    {
+      struct semaphore_elem *waiter
+        = list_entry (list_pop_front (&cond->waiters),
+                      struct semaphore_elem, elem);
+      waiter->thread->waiting_cond = NULL;
+      sema_up (&waiter->semaphore);
+    }
+  intr_set_level (old_level);
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -392,13 +750,238 @@ cond_broadcast (struct condition *cond, struct lock *lock)
     cond_signal (cond, lock);
 }
 
-bool less_sema(const struct list_elem *a, const struct list_elem *b, struct thread *curr){
-  int64_t sema_a = curr->priority;
-  int64_t sema_b = list_entry(list_front(&list_entry(b,struct semaphore_elem,elem)->semaphore.waiters),struct thread,elem)->priority;
-  if(sema_a > sema_b){
-    return true;
-  }
-  else{
-    return false;
-  }
-}
\ No newline at end of file
+/* Moves T, which is waiting on COND, to its place among COND's
+   waiters for the priority it now has.  Called when T's priority
+   changes while it waits.  Interrupts must be off. */
+void
+cond_requeue (struct condition *cond, struct thread *t)
+{
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->waiting_cond == cond);
+
+  for (e = list_begin (&cond->waiters); e != list_end (&cond->waiters);
+       e = list_next (e))
+    if (list_entry (e, struct semaphore_elem, elem)->thread == t)
+      {
+        list_remove (e);
+        insert_ordered_back (&cond->waiters, e, higher_waiter, NULL);
+        return;
+      }
+  NOT_REACHED ();
+}
+
+/* Orders condition variable waiters by descending priority of
+   their threads. */
+static bool
+higher_waiter (const struct list_elem *a_, const struct list_elem *b_,
+               void *aux UNUSED)
+{
+  const struct semaphore_elem *a
+    = list_entry (a_, struct semaphore_elem, elem);
+  const struct semaphore_elem *b
+    = list_entry (b_, struct semaphore_elem, elem);
+
+  return a->thread->priority > b->thread->priority;
+}
+
+/* Initializes RW, which starts out free.  Under "-lp", RW is
+   profiled by the call site of rwlock_init(), through write_lock,
+   which every reader and writer passes through.  The short-held
+   internal lock of all rwlocks shares one record. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init_profiled (&rw->write_lock, NULL, __builtin_return_address (0));
+  lock_init (&rw->lock);
+  cond_init (&rw->no_readers);
+  cond_init (&rw->no_writer);
+  rw->readers = 0;
+  rw->writer = NULL;
+  rw->waiting_writer = NULL;
+  list_init (&rw->holds);
+}
+
+/* Records that the current thread holds RW for reading once
+   more, in its rw_hold for RW, and gives it the priority of any
+   writer waiting for RW's readers.  RW->lock must be held. */
+static void
+rw_hold_get (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  struct rw_hold *hold = NULL;
+  enum intr_level old_level;
+  int i;
+
+  for (i = 0; i < RW_HOLD_MAX; i++)
+    if (cur->rw_holds[i].rw == rw)
+      {
+        cur->rw_holds[i].cnt++;
+        return;
+      }
+  for (i = 0; hold == NULL; i++)
+    {
+      ASSERT (i < RW_HOLD_MAX);
+      if (cur->rw_holds[i].rw == NULL)
+        hold = &cur->rw_holds[i];
+    }
+
+  old_level = intr_disable ();
+  hold->rw = rw;
+  hold->cnt = 1;
+  hold->lock.holder = cur;
+  hold->lock.max_priority = PRI_MIN - 1;
+  list_push_back (&rw->holds, &hold->elem);
+  list_insert_ordered (&cur->lock_list, &hold->lock.elem, less_lock, NULL);
+  if (rw->waiting_writer != NULL && !thread_mlfqs)
+    donate_to (&hold->lock, rw->waiting_writer->priority, 0);
+  intr_set_level (old_level);
+}
+
+/* Drops one of the current thread's holds on RW for reading,
+   giving up any donations received through it once it is the
+   last.  The priority they raised falls back when the caller
+   next releases a lock.  RW->lock must be held. */
+static void
+rw_hold_put (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+  int i;
+
+  for (i = 0; cur->rw_holds[i].rw != rw; i++)
+    ASSERT (i + 1 < RW_HOLD_MAX);
+  if (--cur->rw_holds[i].cnt > 0)
+    return;
+
+  old_level = intr_disable ();
+  list_remove (&cur->rw_holds[i].elem);
+  list_remove (&cur->rw_holds[i].lock.elem);
+  cur->rw_holds[i].lock.holder = NULL;
+  cur->rw_holds[i].rw = NULL;
+  intr_set_level (old_level);
+}
+
+/* Acquires RW for reading, sleeping while a writer holds it or
+   waits for it.  New readers queue on write_lock behind the
+   writer, so a steady stream of readers cannot starve writers,
+   and they donate their priority to it while they wait.
+
+   A thread that already reads some rwlock does not wait behind
+   writers that are merely waiting, since one of them may be
+   waiting for it to finish reading: a thread that reads RW may
+   read it again (e.g. from a page fault taken while copying file
+   data) without deadlock. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->rw_read_cnt == 0)
+    {
+      lock_acquire_adaptive (&rw->write_lock, __builtin_return_address (0));
+      lock_acquire (&rw->lock);
+      rw->readers++;
+      rw_hold_get (rw);
+      lock_release (&rw->lock);
+      lock_release (&rw->write_lock);
+    }
+  else
+    {
+      lock_acquire (&rw->lock);
+      while (rw->writer != NULL)
+        cond_wait (&rw->no_writer, &rw->lock);
+      rw->readers++;
+      rw_hold_get (rw);
+      lock_release (&rw->lock);
+    }
+  cur->rw_read_cnt++;
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+
+  ASSERT (cur->rw_read_cnt > 0);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->readers > 0);
+  if (--rw->readers == 0)
+    cond_signal (&rw->no_readers, &rw->lock);
+  rw_hold_put (rw);
+  lock_release (&rw->lock);
+  cur->rw_read_cnt--;
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it.  Holding write_lock while waiting for the readers to leave
+   keeps new readers from getting in ahead.  Meanwhile the writer
+   donates its priority to the readers, and so does any thread
+   that donates to the writer, so that a low-priority reader
+   cannot keep a high-priority writer waiting behind threads of
+   middling priority. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  lock_acquire_adaptive (&rw->write_lock, __builtin_return_address (0));
+  lock_acquire (&rw->lock);
+  while (rw->readers > 0)
+    {
+      old_level = intr_disable ();
+      rw->waiting_writer = cur;
+      cur->waiting_rw = rw;
+      if (!thread_mlfqs)
+        donate_to_readers (rw, cur->priority, 0);
+      intr_set_level (old_level);
+      cond_wait (&rw->no_readers, &rw->lock);
+    }
+  old_level = intr_disable ();
+  rw->waiting_writer = NULL;
+  cur->waiting_rw = NULL;
+  intr_set_level (old_level);
+  rw->writer = cur;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for writing. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  lock_acquire (&rw->lock);
+  ASSERT (rw->writer == thread_current ());
+  rw->writer = NULL;
+  cond_broadcast (&rw->no_writer, &rw->lock);
+  lock_release (&rw->lock);
+  lock_release (&rw->write_lock);
+}
+
+/* Acquires LOCK, first polling it for up to SPIN_LIMIT rounds
+   while its holder is running, on the theory that a running
+   holder will let go sooner than it would take us to block and
+   be woken.  On a uniprocessor the holder is never running while
+   we are, so this goes straight to lock_acquire().  Waits are
+   credited to SITE in LOCK's profile. */
+static void
+lock_acquire_adaptive (struct lock *lock, const void *site)
+{
+  int spins;
+
+  for (spins = 0; spins < SPIN_LIMIT; spins++)
+    {
+      struct thread *holder = lock->holder;
+
+      if (holder == NULL || holder->status != THREAD_RUNNING
+          || holder == thread_current ())
+        break;
+      barrier ();
+    }
+  lock_acquire_at (lock, site);
+}
@@ -3,18 +3,22 @@
 
 #include <list.h>
 #include <stdbool.h>
+#include <stdint.h>
+
+struct thread;
 
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
+    struct list waiters;        /* Waiting threads, by priority. */
   };
 
 void sema_init (struct semaphore *, unsigned value);
 void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
+void sema_requeue (struct semaphore *, struct thread *);
 void sema_self_test (void);
 
 /* Lock. */
@@ -22,17 +26,24 @@ struct lock
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
-    struct list_elem elem;
+    int max_priority;           /* Highest priority among waiters. */
+    struct list_elem elem;      /* Element in holder's lock_list. */
+    struct lock_profile *profile; /* Contention statistics, or NULL. */
+    int64_t acquired;           /* Tick acquired, if profiled. */
   };
 
-void acquire_sync(struct lock *, struct thread *);
-void release_sync(struct thread *);
+/* If true, gather contention statistics for every lock
+   initialized from then on.  Controlled by kernel command-line
+   option "-lp". */
+extern bool lock_profiling;
 
 void lock_init (struct lock *);
+void lock_init_named (struct lock *, const char *name);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_print_stats (void);
 
 /* Condition variable. */
 struct condition 
@@ -44,7 +55,46 @@ void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
-bool less_sema(const struct list_elem *, const struct list_elem *, struct thread *);
+void cond_requeue (struct condition *, struct thread *);
+
+/* Readers-writer lock.  Any number of readers, or a single
+   writer, may hold it at once.  Waiting writers keep new readers
+   out, and threads that must wait donate their priority to the
+   writer holding or waiting for the lock.  A writer waiting for
+   readers to leave donates its priority to each of them. */
+struct rwlock
+  {
+    struct lock write_lock;     /* Held by the writer, or the writer
+                                   waiting for readers to leave. */
+    struct lock lock;           /* Protects the members below. */
+    struct condition no_readers; /* Signaled when the last reader leaves. */
+    struct condition no_writer; /* Signaled when the writer leaves. */
+    int readers;                /* Number of readers holding it. */
+    struct thread *writer;      /* Thread holding it for writing. */
+    struct thread *waiting_writer; /* Writer waiting for readers. */
+    struct list holds;          /* Readers' holds on it. */
+  };
+
+/* Most rwlocks one thread can hold for reading at once. */
+#define RW_HOLD_MAX 4
+
+/* A thread's hold on an rwlock for reading.  LOCK is never
+   acquired.  It sits in the reader's lock_list, so that a writer
+   waiting for the reader can donate to it the way it would to a
+   lock holder. */
+struct rw_hold
+  {
+    struct lock lock;           /* Receives donations. */
+    struct rwlock *rw;          /* Rwlock held, or null if unused. */
+    int cnt;                    /* Number of times RW is held. */
+    struct list_elem elem;      /* Element in RW's holds. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
 
 /* Optimization barrier.
 
@@ -11,6 +11,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #include "filesys/directory.h"
@@ -22,51 +23,38 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/*less function for list_method argument*/
-bool less_lock(const struct list_elem *a, const struct list_elem *b, void *aux){
-  int64_t priority_a = list_entry(list_front(&list_entry(a, struct lock, elem) -> semaphore .waiters),struct thread, elem)->priority;
-  int64_t priority_b = list_entry(list_front(&list_entry(b, struct lock, elem) -> semaphore .waiters),struct thread, elem)->priority;
-  if(priority_a > priority_b){
-    return true;
-  }
-  else{
-    return false;
-  }
-}
-
-bool less_priority(const struct list_elem *a, const struct list_elem *b, void *aux){
-  int64_t priority_a = list_entry(a, struct thread, elem) -> priority;
-  int64_t priority_b = list_entry(b, struct thread, elem) -> priority;
-  if(priority_a > priority_b){
-    return true;
-  }
-  else{
-    return false;
-  }
-}
-
-bool less(const struct list_elem *a, const struct list_elem *b, void *aux){
-  int64_t end_time_a = list_entry(a, struct thread, elem) -> endtime;
-  int64_t end_time_b = list_entry(b, struct thread, elem) -> endtime;
-  if(end_time_a > end_time_b){
-    return true;
-  }
-  else{
-    return false;
-  }
-}
-
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running, in one FIFO queue per
+   priority.  Bit P of ready_mask is set if and only if
+   ready_queues[P] is nonempty, so the highest ready priority is
+   a single find-last-set. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_mask;
+static int ready_cnt;           /* # of threads in ready_queues. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
-/* List of all sleeping processes.
-*/
-static struct list sleep_list;
+/* Sleeping processes, in a two-level hierarchical timing wheel.
+   A thread due DELTA ticks after wheel_now waits in
+   near_wheel[due % NEAR_SLOTS] if DELTA < NEAR_SLOTS, else in
+   far_wheel[due / NEAR_SLOTS % FAR_SLOTS] if DELTA < NEAR_SLOTS *
+   FAR_SLOTS, else in sleep_overflow.  Each time the near wheel
+   comes round, the next far slot is cascaded down into it, and
+   each time the far wheel comes round, sleep_overflow is
+   redistributed.  Thus a thread is moved at most twice before it
+   wakes (more only if it sleeps for minutes) and a tick costs
+   O(1) plus the threads it wakes. */
+#define NEAR_BITS 8
+#define NEAR_SLOTS (1 << NEAR_BITS)
+#define FAR_BITS 6
+#define FAR_SLOTS (1 << FAR_BITS)
+static struct list near_wheel[NEAR_SLOTS];
+static struct list far_wheel[FAR_SLOTS];
+static struct list sleep_overflow;
+static int64_t wheel_now;       /* Last tick handled by thread_wake(). */
+static int sleep_cnt;           /* # of threads in the wheel. */
 
 /* Idle thread. */
 static struct thread *idle_thread;
@@ -96,11 +84,31 @@ static long long current_ticks;
 #define TIME_SLICE 4            /* # of timer ticks to give each thread. */
 static unsigned thread_ticks;   /* # of timer ticks since last yield. */
 
+/* Time slices at PRI_MAX and at PRI_MIN, in timer ticks.  Threads
+   in between get a slice interpolated linearly between the two,
+   so that low-priority batch work can be given longer slices.
+   Controlled by kernel command-line option "-ts". */
+int thread_slice_high = TIME_SLICE;
+int thread_slice_low = TIME_SLICE;
+
 /* If false (default), use round-robin scheduler.
    If true, use multi-level feedback queue scheduler.
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* Multi-level feedback queue scheduler. */
+#define NICE_MIN -20            /* Lowest niceness. */
+#define NICE_MAX 20             /* Highest niceness. */
+#define PRI_UPDATE_TICKS 4      /* # of ticks between priority updates. */
+static fixed_t load_avg;        /* System load average. */
+static int64_t load_avg_second; /* Second of the last load_avg update. */
+
+static unsigned time_slice (int priority);
+static void mlfqs_tick (void);
+static int mlfqs_priority (const struct thread *);
+static void mlfqs_update_recent_cpu (struct thread *, void *coeff);
+static void mlfqs_update_priority (struct thread *, void *aux);
+
 static void kernel_thread (thread_func *, void *aux);
 
 static void idle (void *aux UNUSED);
@@ -129,12 +137,24 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (i = 0; i <= PRI_MAX; i++)
+    list_init (&ready_queues[i]);
+  ready_mask = 0;
+  ready_cnt = 0;
+  load_avg = 0;
   list_init (&all_list);
-  list_init (&sleep_list);
+  for (i = 0; i < NEAR_SLOTS; i++)
+    list_init (&near_wheel[i]);
+  for (i = 0; i < FAR_SLOTS; i++)
+    list_init (&far_wheel[i]);
+  list_init (&sleep_overflow);
+  wheel_now = 0;
+  sleep_cnt = 0;
   
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
@@ -178,46 +198,179 @@ thread_tick (void)
   else
     kernel_ticks++;
 
-  // printf("name %s",t->name);
-  // printf("  tic : %d sleeping : %d\n", current_ticks, list_size(&sleep_list));
-  // if(list_entry(list_back(&sleep_list), struct thread, elem) -> endtime < 0){
-  //   printf("!!!!!!!");
-  // }
+  if (thread_mlfqs)
+    mlfqs_tick ();
 
   /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  if (++thread_ticks >= time_slice (t->priority))
     intr_yield_on_return ();
 }
 
+/* Returns the length of the time slice, in timer ticks, that a
+   thread at PRIORITY gets. */
+static unsigned
+time_slice (int priority)
+{
+  return (thread_slice_low
+          + (thread_slice_high - thread_slice_low) * (priority - PRI_MIN)
+            / (PRI_MAX - PRI_MIN));
+}
+
+/* Puts sleeping thread T in the timing wheel slot for its
+   wake-up time. */
+static void
+wheel_insert (struct thread *t)
+{
+  int64_t delta = t->endtime - wheel_now;
+  struct list *slot;
+
+  if (delta < NEAR_SLOTS)
+    slot = &near_wheel[t->endtime & (NEAR_SLOTS - 1)];
+  else if (delta < (int64_t) NEAR_SLOTS * FAR_SLOTS)
+    slot = &far_wheel[(t->endtime >> NEAR_BITS) & (FAR_SLOTS - 1)];
+  else
+    slot = &sleep_overflow;
+  list_push_back (slot, &t->elem);
+}
+
+/* Redistributes the threads in SLOT over the timing wheel, now
+   that wheel_now has moved on. */
+static void
+wheel_cascade (struct list *slot)
+{
+  struct list threads;
+
+  if (list_empty (slot))
+    return;
+  list_init (&threads);
+  list_splice (list_end (&threads), list_begin (slot), list_end (slot));
+  while (!list_empty (&threads))
+    wheel_insert (list_entry (list_pop_front (&threads),
+                              struct thread, elem));
+}
+
+/* Wakes up every sleeping thread due at or before TICKS.
+   Called from the timer interrupt. */
 void
 thread_wake(int64_t ticks)
 {
-  // printf("wake : %s\n",thread_current()->name );
   current_ticks = ticks;
-  while(!list_empty(&sleep_list) && (list_entry(list_back(&sleep_list), struct thread, elem) -> endtime) <= ticks){
-    struct thread *temp = list_entry(list_pop_back(&sleep_list),struct thread, elem);
-    // printf("%lld vs %lld  ",list_entry(list_tail(&sleep_list), struct thread, elem) -> endtime,kernel_ticks);
-    // printf("%d popped tid : %d\n", kernel_ticks, temp->tid);
-    thread_unblock(temp);
-  }
+  while (wheel_now < ticks)
+    {
+      struct list *slot;
+
+      wheel_now++;
+      if ((wheel_now & (NEAR_SLOTS - 1)) == 0)
+        {
+          int far = (wheel_now >> NEAR_BITS) & (FAR_SLOTS - 1);
+          if (far == 0)
+            wheel_cascade (&sleep_overflow);
+          wheel_cascade (&far_wheel[far]);
+        }
+
+      slot = &near_wheel[wheel_now & (NEAR_SLOTS - 1)];
+      while (!list_empty (slot))
+        {
+          sleep_cnt--;
+          thread_unblock (list_entry (list_pop_front (slot),
+                                      struct thread, elem));
+        }
+    }
 }
 
+/* Returns the first tick after the current one at which a
+   sleeping thread may need waking, looking at most LIMIT ticks
+   ahead.  If none can be due that soon, returns the tick LIMIT
+   ticks from now.  A tick at which the near wheel comes round is
+   always reported, since the cascade may bring due threads into
+   it. */
+int64_t
+thread_next_wakeup (int limit)
+{
+  int64_t t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (limit > 0 && limit <= NEAR_SLOTS);
+
+  for (t = wheel_now + 1; t < wheel_now + limit; t++)
+    if ((t & (NEAR_SLOTS - 1)) == 0
+        || !list_empty (&near_wheel[t & (NEAR_SLOTS - 1)]))
+      return t;
+  return wheel_now + limit;
+}
 
+/* Makes the current thread sleep until timer tick ENDTIME.  The
+   caller must turn interrupts off and then block.  A deadline
+   that has already passed wakes the thread on the next tick. */
 void
 thread_insert_sleep(int64_t endtime){
-  
   struct thread *t = thread_current ();
-  // printf("%lld current : %d %s end at %d\n",kernel_ticks,t->tid,t->name,endtime);
-  t->endtime = endtime;
-  list_insert_ordered(&sleep_list, &t->elem,less,NULL);
 
+  ASSERT (intr_get_level () == INTR_OFF);
+  t->endtime = endtime > wheel_now ? endtime : wheel_now + 1;
+  wheel_insert (t);
+  sleep_cnt++;
 }
 
+/* Appends T to the ready queue for its priority. */
 void
 thread_insert_ready(struct thread *t){
-  // printf("insert : %s %d\n",t->name,t->priority);
-  list_insert_ordered(&ready_list, &t->elem,less_priority,NULL);
-  //printf("size: %d\n",list_size(&ready_list));
+  ASSERT (intr_get_level () == INTR_OFF);
+  list_push_back (&ready_queues[t->priority], &t->elem);
+  ready_mask |= (uint64_t) 1 << t->priority;
+  ready_cnt++;
+}
+
+/* Removes ready thread T from the ready queue for its
+   priority. */
+static void
+remove_ready (struct thread *t)
+{
+  list_remove (&t->elem);
+  if (list_empty (&ready_queues[t->priority]))
+    ready_mask &= ~((uint64_t) 1 << t->priority);
+  ready_cnt--;
+}
+
+/* Returns the highest priority among ready threads, or -1 if no
+   thread is ready. */
+int
+thread_max_ready_priority (void)
+{
+  uint32_t hi = ready_mask >> 32;
+  uint32_t lo = ready_mask;
+
+  if (hi != 0)
+    return 63 - __builtin_clz (hi);
+  if (lo != 0)
+    return 31 - __builtin_clz (lo);
+  return -1;
+}
+
+/* Changes T's effective priority to PRIORITY, moving T to the
+   matching ready queue if it is waiting to run, or to its new
+   place among a semaphore's or condition variable's waiters if
+   it is waiting for one.  Interrupts must be off. */
+void
+thread_change_priority (struct thread *t, int priority)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
+
+  if (t->status == THREAD_READY && t != idle_thread)
+    {
+      remove_ready (t);
+      t->priority = priority;
+      thread_insert_ready (t);
+    }
+  else
+    {
+      t->priority = priority;
+      if (t->status == THREAD_BLOCKED && t->waiting_sema != NULL)
+        sema_requeue (t->waiting_sema, t);
+      if (t->waiting_cond != NULL)
+        cond_requeue (t->waiting_cond, t);
+    }
 }
 
 
@@ -226,23 +379,21 @@ thread_insert_ready(struct thread *t){
 
 //Debugging with print
 void print_current(void){ //print information of current thread
-  printf("tid : %d , sleeping : %d\n",thread_current()->tid,list_size(&sleep_list));
-}
-
-// void print_list(struct list l){ // print whole members of input list
-//   int i =0;
-//   struct list_elem *e;
-//   printf("NOW : %d\n",kernel_ticks);
-//   printf("Sleeping list :\n");
-//   if(list_size(&l)==0){
-//     printf("Empty list\n\n");
-//   }
-//   for(e= list_begin(&sleep_list);e!=list_end(&sleep_list); ){
-//     printf("#%d<tid:%d, name:%s end:%d>\n",i++,list_entry(e,struct thread, elem)->tid,list_entry(e,struct thread, elem)->name, list_entry(e,struct thread, elem)->endtime);
-//     e = list_next(e);
-//   }
-//   printf("\n\n");
-// }
+  printf("tid : %d , sleeping : %d\n",thread_current()->tid,sleep_cnt);
+}
+
+/* Credits N timer ticks that passed while the CPU was halted in
+   the idle thread but for which thread_tick() was never called,
+   because the idle thread left tickless idle before the one-shot
+   timer interrupt fired. */
+void
+thread_idle_ticks (int64_t n)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (n >= 0);
+
+  idle_ticks += n;
+}
 
 /* Prints thread statistics. */
 void
@@ -348,9 +499,11 @@ thread_unblock (struct thread *t)
   ASSERT (t->status == THREAD_BLOCKED);
   thread_insert_ready(t);
   t->status = THREAD_READY;
-  if(thread_current() != idle_thread && !list_empty(&ready_list) && thread_current()->priority < list_entry(list_front(&ready_list), struct thread, elem) -> priority){
-    // printf("yield in unblock\n");
-    thread_yield();
+  if(thread_current() != idle_thread && thread_current()->priority < t->priority){
+    if (intr_context ())
+      intr_yield_on_return ();
+    else
+      thread_yield();
   }
   // printf("no yeild in unblock\n");  
   intr_set_level (old_level);
@@ -448,10 +601,14 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's priority to NEW_PRIORITY.
+   Ignored under the multi-level feedback queue scheduler, which
+   computes priorities itself. */
 void
 thread_set_priority (int new_priority) 
 {
+  if (thread_mlfqs)
+    return;
   if(thread_current()->priority != thread_current()->real_priority){
     if(thread_current()->priority <new_priority){
       thread_current()->priority = new_priority;
@@ -463,7 +620,7 @@ thread_set_priority (int new_priority)
     thread_current()->real_priority = new_priority;
   }
 
-  if((!list_empty(&ready_list)) && thread_current()->priority < list_entry(list_front(&ready_list), struct thread, elem) -> priority){
+  if(thread_current()->priority < thread_max_ready_priority()){
     thread_yield();
   }
 }
@@ -475,35 +632,128 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE, recalculates its
+   priority, and yields if it no longer has the highest. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
 {
-  /* Not yet implemented. */
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  if (nice < NICE_MIN)
+    nice = NICE_MIN;
+  else if (nice > NICE_MAX)
+    nice = NICE_MAX;
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    cur->priority = mlfqs_priority (cur);
+  intr_set_level (old_level);
+
+  if (cur->priority < thread_max_ready_priority ())
+    thread_yield ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load = fp_round (load_avg * 100);
+  intr_set_level (old_level);
+  return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent = fp_round (thread_current ()->recent_cpu * 100);
+  intr_set_level (old_level);
+  return recent;
+}
+
+/* Does the multi-level feedback queue scheduler's bookkeeping
+   for one timer tick.  Only the running thread's recent_cpu
+   changes from tick to tick, so only its priority is recomputed
+   every PRI_UPDATE_TICKS ticks; every thread is visited just
+   once a second, when load_avg and all recent_cpu values
+   decay. */
+static void
+mlfqs_tick (void)
+{
+  struct thread *cur = thread_current ();
+  int64_t ticks = timer_ticks ();
+
+  if (cur != idle_thread)
+    cur->recent_cpu = fp_add_int (cur->recent_cpu, 1);
+
+  /* Compare seconds rather than testing for a whole second's
+     tick, because the tickless idle loop can step the clock over
+     that tick without calling us. */
+  if (ticks / timer_freq != load_avg_second)
+    {
+      load_avg_second = ticks / timer_freq;
+      int ready = ready_cnt + (cur != idle_thread);
+      fixed_t twice_load;
+      fixed_t coeff;
+
+      load_avg = (fp_mul (fp_div (fp_from_int (59), fp_from_int (60)),
+                          load_avg)
+                  + fp_from_int (ready) / 60);
+      twice_load = 2 * load_avg;
+      coeff = fp_div (twice_load, fp_add_int (twice_load, 1));
+      thread_foreach (mlfqs_update_recent_cpu, &coeff);
+      thread_foreach (mlfqs_update_priority, NULL);
+    }
+  else if (ticks % PRI_UPDATE_TICKS == 0 && cur != idle_thread)
+    cur->priority = mlfqs_priority (cur);
+
+  if (cur->priority < thread_max_ready_priority ())
+    intr_yield_on_return ();
+}
+
+/* Returns the priority the multi-level feedback queue scheduler
+   gives T. */
+static int
+mlfqs_priority (const struct thread *t)
+{
+  int priority = PRI_MAX - fp_trunc (t->recent_cpu / 4) - t->nice * 2;
+
+  if (priority < PRI_MIN)
+    return PRI_MIN;
+  if (priority > PRI_MAX)
+    return PRI_MAX;
+  return priority;
+}
+
+/* Decays T's recent_cpu by the factor *COEFF_ and adds in its
+   nice value. */
+static void
+mlfqs_update_recent_cpu (struct thread *t, void *coeff_)
+{
+  fixed_t *coeff = coeff_;
+
+  if (t != idle_thread)
+    t->recent_cpu = fp_add_int (fp_mul (*coeff, t->recent_cpu), t->nice);
+}
+
+/* Recomputes T's priority, moving it between ready queues as
+   needed. */
+static void
+mlfqs_update_priority (struct thread *t, void *aux UNUSED)
+{
+  if (t != idle_thread)
+    thread_change_priority (t, mlfqs_priority (t));
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -528,6 +778,10 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nothing is ready, so let the timer skip the ticks before
+         the next sleeping thread is due. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -541,6 +795,10 @@ idle (void *idle_started_ UNUSED)
          See [IA32-v2a] "HLT", [IA32-v2b] "STI", and [IA32-v3a]
          7.11.1 "HLT Instruction". */
       asm volatile ("sti; hlt" : : : "memory");
+
+      /* Whatever woke us, go back to ticking periodically. */
+      intr_disable ();
+      timer_idle_exit ();
     }
 }
 
@@ -582,6 +840,7 @@ static void
 init_thread (struct thread *t, const char *name, int priority)
 {
   enum intr_level old_level;
+  int i;
   
   ASSERT (t != NULL);
   ASSERT (PRI_MIN <= priority && priority <= PRI_MAX);
@@ -594,20 +853,36 @@ init_thread (struct thread *t, const char *name, int priority)
   t->priority = priority;
   t->real_priority = priority;
   t->magic = THREAD_MAGIC;
+  if (t != running_thread ())
+    {
+      t->nice = running_thread ()->nice;
+      t->recent_cpu = running_thread ()->recent_cpu;
+    }
+  if (thread_mlfqs)
+    t->priority = mlfqs_priority (t);
   list_init(&t->lock_list);
-  list_init(&t->fd_list);
+  for (i = 0; i < RW_HOLD_MAX; i++)
+    lock_init (&t->rw_holds[i].lock);
+  t->parent =  running_thread();
+#ifdef USERPROG
+  t->fd_table = NULL;
+  t->fd_cap = 0;
+  t->fd_map = NULL;
   list_init(&t->child_list);
-  list_init(&t->mmap_list);
   sema_init(&t->sync_exit,0);
   sema_init(&t->sync_free,0);
   sema_init(&t->loading,0);
   t->is_waiting = false;
-  t->esp = PHYS_BASE;
-  t->parent =  running_thread();
   
   list_push_back(&running_thread()->child_list,&t->child_elem);
 
   t->exit_status = -1;
+#endif
+#ifdef VM
+  list_init(&t->mmap_list);
+  t->next_mapid = 0;
+  t->esp = PHYS_BASE;
+#endif
 
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
@@ -635,10 +910,14 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  int priority = thread_max_ready_priority ();
+  struct thread *t;
+
+  if (priority < 0)
     return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+  t = list_entry (list_front (&ready_queues[priority]), struct thread, elem);
+  remove_ready (t);
+  return t;
 }
 
 /* Completes a thread switch by activating the new thread's page
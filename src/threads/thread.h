@@ -5,6 +5,7 @@
 #include <list.h>
 #include <stdint.h>
 #include "threads/synch.h"
+#include "threads/fixed-point.h"
 #ifdef VM
 #include "vm/page.h"
 #endif
@@ -95,19 +96,28 @@ struct thread
     struct list_elem allelem;           /* List element for all threads list. */
    int64_t endtime;                    /* Time when thread need to wake up*/
    int real_priority;                  /*original priority before/after donation*/
-   struct lock *waiting_lock;
-   struct list lock_list;
+   struct lock *waiting_lock;          /* Lock being waited for, if any. */
+   struct list lock_list;              /* Locks held, by max_priority. */
+   int nice;                           /* Niceness, for -mlfqs. */
+   fixed_t recent_cpu;                 /* Recent CPU use, for -mlfqs. */
 
 
     /* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
+    struct semaphore *waiting_sema;     /* Semaphore being waited for. */
+    struct condition *waiting_cond;     /* Condition being waited on. */
+    int rw_read_cnt;                    /* # of rwlocks held for reading. */
+    struct rw_hold rw_holds[RW_HOLD_MAX]; /* Those rwlocks. */
+    struct rwlock *waiting_rw;          /* Rwlock whose readers it awaits. */
    
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
    int exit_status;
    uint32_t *pagedir;                  /* Page directory. */
-   struct list fd_list;
+   struct file_descriptor **fd_table;  /* Open files, indexed by fd. */
+   size_t fd_cap;                      /* Number of slots in fd_table. */
+   struct bitmap *fd_map;              /* In-use slots of fd_table. */
    struct list child_list;
    struct list_elem child_elem;
    struct semaphore sync_exit;
@@ -120,9 +130,12 @@ struct thread
    struct hash spt;
    void* esp;
    struct list mmap_list;
+   int next_mapid;                     /* mapid for the next mmap(). */
 #endif
    struct thread *parent;
    struct dir *dir;
+   int journal_depth;                  /* Nesting of journal_begin(). */
+   int journal_slots;                  /* Log sectors left to it. */
 
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
@@ -133,19 +146,25 @@ struct thread
    Controlled by kernel command-line option "-o mlfqs". */
 extern bool thread_mlfqs;
 
+/* Time slices, in timer ticks, for threads at PRI_MAX and at
+   PRI_MIN.  Controlled by kernel command-line option "-ts". */
+extern int thread_slice_high;
+extern int thread_slice_low;
+
 void thread_init (void);
 void thread_start (void);
 
 /*Implemented*/
-bool less_lock(const struct list_elem *, const struct list_elem *, void *);
-bool less_priority(const struct list_elem *, const struct list_elem *, void *);
-bool less(const struct list_elem *, const struct list_elem *, void *);
 void print_current(void);
 void thread_insert_sleep(int64_t);
 void thread_wake(int64_t current_tick);
+int64_t thread_next_wakeup (int limit);
 void thread_insert_ready(struct thread *);
+int thread_max_ready_priority (void);
+void thread_change_priority (struct thread *, int priority);
 
 void thread_tick (void);
+void thread_idle_ticks (int64_t);
 void thread_print_stats (void);
 
 typedef void thread_func (void *aux);
@@ -286,17 +286,7 @@ process_exit (void)
       pagedir_activate (NULL);
       pagedir_destroy (pd);
     } 
-  struct list_elem *e;
-  struct file_descriptor *temp;
-  if(!list_empty(&cur->fd_list)){
-    for(e=list_begin(&cur->fd_list) ;e->next !=NULL ; ){
-      temp = list_entry(e,struct file_descriptor,elem);
-      // munmap(temp->fd);
-      file_close(temp->file);
-      e = list_remove(&temp->elem);
-      free(temp);
-    }
-  }
+  fd_table_destroy();
   // hash_destroy(&cur->spt,spt_hash_func);
   if(!cur->is_waiting) //parent가 기다리지 않는 경우
     list_remove(&cur->child_elem);
@@ -1,10 +1,13 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
+#include <limits.h>
 #include <syscall-nr.h>
+#include <bitmap.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "userprog/pagedir.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
 #include "threads/pte.h"
 #include "vm/page.h"
@@ -24,29 +27,97 @@ get_user (const uint8_t *uaddr) {
   return result;
 }
 
+/* Descriptors 0, 1 and 2 are never handed out by open(). */
+#define FD_FIRST 3
+
+/* Initial number of slots in a process's descriptor table. */
+#define FD_TABLE_INIT 16
+
 static struct file_descriptor *fd_to_fd(int fd)
 {
-  struct list *fd_list = &thread_current()->fd_list;
-  struct list_elem *e;
-  struct file_descriptor *target;
-  if (list_empty(fd_list))
+  struct thread *cur = thread_current();
+  if (fd < 0 || (size_t) fd >= cur->fd_cap)
     return NULL;
-  // print_list(fd_list);
-  for (e = list_begin(fd_list); e != list_end(fd_list); e = list_next(e))
+  return cur->fd_table[fd];
+}
+
+/* Doubles the current process's descriptor table, creating it
+   on first use.  Only called when every slot is taken, so all
+   of the old slots are marked in use in the new bitmap. */
+static bool fd_table_grow(struct thread *cur)
+{
+  size_t old_cap = cur->fd_cap;
+  size_t new_cap = old_cap == 0 ? FD_TABLE_INIT : old_cap * 2;
+  struct file_descriptor **table;
+  struct bitmap *map;
+
+  map = bitmap_create(new_cap);
+  if (map == NULL)
+    return false;
+  table = realloc(cur->fd_table, new_cap * sizeof *table);
+  if (table == NULL)
   {
-    if (e->next == NULL)
-    {
-      return NULL;
-    }
-    target = list_entry(e, struct file_descriptor, elem);
+    bitmap_destroy(map);
+    return false;
+  }
+  memset(table + old_cap, 0, (new_cap - old_cap) * sizeof *table);
+  bitmap_set_multiple(map, 0, old_cap == 0 ? FD_FIRST : old_cap, true);
 
-    if (target->fd == fd)
-    {
-      return target;
-    }
-    // printf("tf : %d\n",e == list_tail(fd_list) );
+  bitmap_destroy(cur->fd_map);
+  cur->fd_table = table;
+  cur->fd_map = map;
+  cur->fd_cap = new_cap;
+  return true;
+}
+
+/* Puts DESC in the lowest free slot of the current process's
+   descriptor table and returns its fd, or -1 if out of memory. */
+static int fd_install(struct file_descriptor *desc)
+{
+  struct thread *cur = thread_current();
+  size_t fd = BITMAP_ERROR;
+
+  if (cur->fd_map != NULL)
+    fd = bitmap_scan_and_flip(cur->fd_map, 0, 1, false);
+  if (fd == BITMAP_ERROR)
+  {
+    if (!fd_table_grow(cur))
+      return -1;
+    fd = bitmap_scan_and_flip(cur->fd_map, 0, 1, false);
   }
-  return NULL;
+  desc->fd = fd;
+  cur->fd_table[fd] = desc;
+  return fd;
+}
+
+/* Closes DESC and frees its slot for reuse. */
+static void fd_release(struct file_descriptor *desc)
+{
+  struct thread *cur = thread_current();
+
+  cur->fd_table[desc->fd] = NULL;
+  bitmap_reset(cur->fd_map, desc->fd);
+  file_close(desc->file);
+  if (desc->dir != NULL)
+    dir_close(desc->dir);
+  free(desc);
+}
+
+/* Closes every file the current process still has open and
+   frees its descriptor table. */
+void fd_table_destroy(void)
+{
+  struct thread *cur = thread_current();
+  size_t fd;
+
+  for (fd = 0; fd < cur->fd_cap; fd++)
+    if (cur->fd_table[fd] != NULL)
+      fd_release(cur->fd_table[fd]);
+  free(cur->fd_table);
+  bitmap_destroy(cur->fd_map);
+  cur->fd_table = NULL;
+  cur->fd_map = NULL;
+  cur->fd_cap = 0;
 }
 
 static void is_valid_arg(void* p){
@@ -252,6 +323,70 @@ syscall_handler(struct intr_frame *f)
     }
     f->eax = inumber(*(int *)(esp + 1));
     break; 
+
+  case SYS_READV:
+    if (!is_userspace(esp, 3))
+    {
+      exit(-1);
+    }
+    f->eax = readv(*(int *)(esp + 1), (const struct iovec *)(*(esp + 2)), *(int *)(esp + 3));
+    break;
+
+  case SYS_WRITEV:
+    if (!is_userspace(esp, 3))
+    {
+      exit(-1);
+    }
+    f->eax = writev(*(int *)(esp + 1), (const struct iovec *)(*(esp + 2)), *(int *)(esp + 3));
+    break;
+
+  case SYS_PREAD:
+    if (!is_userspace(esp, 4))
+    {
+      exit(-1);
+    }
+    f->eax = pread(*(int *)(esp + 1), (void *)(*(esp + 2)), *(unsigned *)(esp + 3), *(unsigned *)(esp + 4));
+    break;
+
+  case SYS_PWRITE:
+    if (!is_userspace(esp, 4))
+    {
+      exit(-1);
+    }
+    f->eax = pwrite(*(int *)(esp + 1), (const void *)(*(esp + 2)), *(unsigned *)(esp + 3), *(unsigned *)(esp + 4));
+    break;
+
+  case SYS_GETDENTS:
+    if (!is_userspace(esp, 3))
+    {
+      exit(-1);
+    }
+    f->eax = getdents(*(int *)(esp + 1), (struct dirent *)(*(esp + 2)), *(unsigned *)(esp + 3));
+    break;
+
+  case SYS_STAT:
+    if (!is_userspace(esp, 2))
+    {
+      exit(-1);
+    }
+    f->eax = stat((const char *)(*(esp + 1)), (struct stat *)(*(esp + 2)));
+    break;
+
+  case SYS_FSTAT:
+    if (!is_userspace(esp, 2))
+    {
+      exit(-1);
+    }
+    f->eax = fstat(*(int *)(esp + 1), (struct stat *)(*(esp + 2)));
+    break;
+
+  case SYS_FALLOCATE:
+    if (!is_userspace(esp, 2))
+    {
+      exit(-1);
+    }
+    f->eax = fallocate(*(int *)(esp + 1), *(unsigned *)(esp + 2));
+    break;
            
   default:
     break;
@@ -294,18 +429,14 @@ bool create(const char *file, unsigned initial_size)
     exit(-1);
   }
   is_valid_arg(file);
-  lock_acquire(&sys_lock);
   result = filesys_create(file, initial_size,0);
-  lock_release(&sys_lock);
   return result;
 }
 
 bool remove(const char *file)
 {
   is_valid_arg(file); 
-  lock_acquire(&sys_lock);
   bool result = filesys_remove(file);
-  lock_release(&sys_lock);
   return result;
 }
 
@@ -316,73 +447,61 @@ int open(const char *file)
     exit(-1);
   }
   is_valid_arg(file);
-  lock_acquire(&sys_lock);
   struct file *open_file = filesys_open(file);
   if (open_file == NULL)
   {
-    lock_release(&sys_lock);
     return -1;
   }
 
-  int new_fd;
-  if (!list_empty(&thread_current()->fd_list))
-  {
-    new_fd = (list_entry(list_back(&thread_current()->fd_list), struct file_descriptor, elem)->fd) + 1;
-  }
-  else
-  {
-    new_fd = 3;
-  }
   if(!strcmp(thread_current()->name,file))
     file_deny_write(open_file);
 
-  struct list_elem *e = (struct list_elem *)malloc(sizeof(struct list_elem));
-  e->next = NULL;
-  e->prev = NULL;
   struct file_descriptor *fd = (struct file_descriptor *)malloc(sizeof(struct file_descriptor));
-  fd->fd = new_fd;
+  if (fd == NULL)
+  {
+    file_close(open_file);
+    return -1;
+  }
   fd->file = open_file;
   fd->dir = NULL;
   if(file_get_inode(open_file) != NULL && file_is_dir(open_file)){
     fd->dir = dir_open(inode_reopen(file_get_inode(open_file)));
   }
-  memcpy(&(fd->elem),e,sizeof(struct list_elem));
-  free(e);
-  
-  list_push_back(&thread_current()->fd_list, &fd->elem);
-  lock_release(&sys_lock);
+
+  int new_fd = fd_install(fd);
+  if (new_fd < 0)
+  {
+    if (fd->dir != NULL)
+      dir_close(fd->dir);
+    file_close(open_file);
+    free(fd);
+  }
   return new_fd;
 }
 
 int filesize(int fd)
 {
-  lock_acquire(&sys_lock);
   struct file_descriptor *file = fd_to_fd(fd);
   if (file == NULL)
   {
-    lock_release(&sys_lock);
     return -1;
   }
   int result = file_length(file->file);
-  lock_release(&sys_lock);
   return result;
 }
 
 int read(int fd, void *buffer, unsigned size)
 {
-  lock_acquire(&sys_lock);
   is_valid_arg(buffer);
   // printf("buffer : %p\n",pg_round_down(buffer));
   int result;
   if (fd == 0)
   {
     result = input_getc();
-    lock_release(&sys_lock);
     return result;
   }
   struct file_descriptor *file = fd_to_fd(fd);
   if (file == NULL){
-    lock_release(&sys_lock);
     return -1;
   }
 
@@ -392,20 +511,16 @@ int read(int fd, void *buffer, unsigned size)
   result = file_read(file->file, buffer, size);
   set_evict_file(buffer,size,false);
   
-  lock_release(&sys_lock);
   return result;
 }
 
 int write(int fd, const void *buffer, unsigned size)
 {
-  lock_acquire(&sys_lock);
-
   is_valid_arg(buffer);
   int result;
   if (fd == 1)
   {
     putbuf(buffer, size); //실제로는??
-    lock_release(&sys_lock);
     return size;
   }
   else
@@ -413,11 +528,9 @@ int write(int fd, const void *buffer, unsigned size)
     struct file_descriptor *file = fd_to_fd(fd);
     if (file == NULL)
     {
-      lock_release(&sys_lock);
       return -1;
     }
     if(file_is_dir(file->file)){
-      lock_release(&sys_lock);
       return -1;
     }
     set_evict_file(buffer,size,true);
@@ -425,49 +538,38 @@ int write(int fd, const void *buffer, unsigned size)
     set_evict_file(buffer,size,false);
 
 
-    lock_release(&sys_lock);
     return result;
   }
 }
 
 void seek(int fd, unsigned position)
 {
-  lock_acquire(&sys_lock);
-  struct file * f = fd_to_fd(fd)->file;
-  if(!f){
-    lock_release(&sys_lock);
+  struct file_descriptor *file = fd_to_fd(fd);
+  if(!file){
     return;
   }
-  file_seek(f, position);
-  lock_release(&sys_lock);
+  file_seek(file->file, position);
 }
 
 unsigned tell(int fd)
 {
-  lock_acquire(&sys_lock);
-  unsigned result = file_tell(fd_to_fd(fd)->file);
-  lock_release(&sys_lock);
-  return result;
+  struct file_descriptor *file = fd_to_fd(fd);
+  if(!file){
+    return -1;
+  }
+  return file_tell(file->file);
 }
 
 void close(int fd)
 {
   // 닫힌 fd값 free해주기
-  lock_acquire(&sys_lock);
   struct file_descriptor *temp = fd_to_fd(fd);
   if (temp != NULL)
   {
-    list_remove(&(temp->elem));
-    file_close(temp->file);
-    if(temp->dir != NULL){
-      dir_close(temp->dir);
-    }
-    free(temp);
-    lock_release(&sys_lock);
+    fd_release(temp);
   }
   else
   {
-    lock_release(&sys_lock);
     exit(-1);
   }
 }
@@ -483,15 +585,17 @@ int mmap(int fd, void *addr){
   if(pg_ofs(addr) != 0){
     return -1;
   }
-  int mapid = fd;
-  
-
   struct file_descriptor *file = fd_to_fd(fd);
   struct file* f;
+  int mapid;
   
   if(!file)
     return -1;
 
+  /* Mapping ids are never reused, unlike file descriptors, so a
+     stale id cannot name a newer mapping. */
+  mapid = thread_current()->next_mapid++;
+
   lock_acquire(&sys_lock);
   f = file_reopen(file->file);
   // f = file->file;
@@ -564,7 +668,6 @@ void munmap(int id){
 }
 
 bool chdir(const char *dir){
-  lock_acquire(&sys_lock);
   struct dir* new_dir = open_directories(dir);
   bool success = new_dir!=NULL;
   if(success){
@@ -572,54 +675,323 @@ bool chdir(const char *dir){
     thread_current()->dir = new_dir;
     // printf("%p\n",new_dir);
   }
-  lock_release(&sys_lock);
   return success;
 }
 
 bool mkdir(const char *dir){
-  lock_acquire(&sys_lock);
   bool result = filesys_create(dir,0,1);
-  lock_release(&sys_lock);
   return result;
 }
 
 bool readdir(int fd, char* name){
-  lock_acquire(&sys_lock);
   struct file_descriptor * file = fd_to_fd(fd);
   if(file == NULL){
-    lock_release(&sys_lock);  
     return false;
   }
   bool result = false;
   if(!file_is_dir(file->file)){
-    lock_release(&sys_lock);  
     return false;
   }
   result = dir_readdir(file->dir,name);
   // printf("%s %d\n",name,result);
-  lock_release(&sys_lock);  
   return result;
 }
 
 bool isdir(int fd){
-  lock_acquire(&sys_lock);
   struct file* file = fd_to_fd(fd)->file;
-  lock_release(&sys_lock);
   return file_is_dir(file);
 }
 
 int inumber(int fd){
-  lock_acquire(&sys_lock);
   struct file_descriptor * file = fd_to_fd(fd);
   if(file == NULL){
-      lock_release(&sys_lock);
       return -1;
   }
-  lock_release(&sys_lock);
   return inode_to_inum(file->file);
 
 }
 
+/* Kills the process unless the SIZE bytes at BUFFER lie in
+   mapped user memory.  Checks exactly what set_evict_file() does,
+   without pinning anything. */
+static void check_user_buffer(const void *buffer, unsigned size){
+  const uint8_t *bound = (const uint8_t *) buffer + size;
+  const uint8_t *temp;
+
+  is_valid_arg((void *) buffer);
+  is_valid_arg((void *) (bound - 1));
+  for (temp = pg_round_down(buffer); temp < bound; temp += PGSIZE)
+    if (get_user(temp) == -1 || spt_get_spte((void *) temp) == NULL)
+      exit(-1);
+}
+
+/* Copies the IOVCNT buffers described by user array UIOV into
+   kernel array IOV, which must have room for IOV_MAX elements,
+   and pins the buffers.  Stores their total size into *TOTAL.
+   Returns true if successful, false if IOVCNT is out of range or
+   the total does not fit in an int.  Kills the process on a bad
+   address, but only before pinning or allocating anything: the
+   array and every buffer are checked first. */
+static bool iov_acquire(struct iovec *iov, const struct iovec *uiov,
+                        int iovcnt, size_t *total){
+  size_t size = iovcnt * sizeof *uiov;
+  int i;
+
+  if (iovcnt <= 0 || iovcnt > IOV_MAX)
+    return false;
+  check_user_buffer(uiov, size);
+  memcpy(iov, uiov, size);
+
+  *total = 0;
+  for (i = 0; i < iovcnt; i++){
+    if (iov[i].iov_len == 0)
+      continue;
+    check_user_buffer(iov[i].iov_base, iov[i].iov_len);
+    if (iov[i].iov_len > (size_t) INT_MAX - *total)
+      return false;
+    *total += iov[i].iov_len;
+  }
+
+  /* User processes have a single thread, so nothing can unmap a
+     buffer between the checks above and pinning it. */
+  for (i = 0; i < iovcnt; i++)
+    if (iov[i].iov_len > 0)
+      set_evict_file(iov[i].iov_base, iov[i].iov_len, true);
+  return true;
+}
+
+/* Unpins the buffers in IOV, which has IOVCNT elements. */
+static void iov_release(struct iovec *iov, int iovcnt){
+  int i;
+
+  for (i = 0; i < iovcnt; i++)
+    if (iov[i].iov_len > 0)
+      set_evict_file(iov[i].iov_base, iov[i].iov_len, false);
+}
+
+/* Copies SIZE bytes between kernel buffer BUF and the buffers in
+   IOV, starting OFS bytes into the latter: into IOV if TO_IOV is
+   true, out of it otherwise. */
+static void iov_copy(const struct iovec *iov, int iovcnt, size_t ofs,
+                     uint8_t *buf, size_t size, bool to_iov){
+  int i;
+
+  for (i = 0; i < iovcnt && size > 0; i++){
+    uint8_t *base = iov[i].iov_base;
+    size_t n;
+
+    if (ofs >= iov[i].iov_len){
+      ofs -= iov[i].iov_len;
+      continue;
+    }
+    n = iov[i].iov_len - ofs < size ? iov[i].iov_len - ofs : size;
+    if (to_iov)
+      memcpy(base + ofs, buf, n);
+    else
+      memcpy(buf, base + ofs, n);
+    buf += n;
+    size -= n;
+    ofs = 0;
+  }
+}
+
+/* Does the work of readv() if WRITING is false, of writev() if
+   it is true.  A single nonempty buffer is used directly, in one
+   file_read() or file_write().  Otherwise the buffers are
+   gathered into (or scattered from) a kernel buffer of at most a
+   page, so a transfer of up to a page is a single file_read() or
+   file_write(), as atomic as read() or write() would be, and a
+   larger one takes a page at a time.  Reading the keyboard
+   behaves exactly like read() on fd 0. */
+static int iov_transfer(int fd, const struct iovec *uiov, int iovcnt, bool writing){
+  struct iovec iov[IOV_MAX];
+  struct file_descriptor *file = NULL;
+  struct iovec *only = NULL;
+  uint8_t *buf;
+  size_t total, done, buf_size;
+  int i, n;
+
+  if (iovcnt == 0)
+    return 0;
+  if (fd != (writing ? 1 : 0)){
+    file = fd_to_fd(fd);
+    if (file == NULL || (writing && file_is_dir(file->file)))
+      return -1;
+  }
+  if (!iov_acquire(iov, uiov, iovcnt, &total))
+    return -1;
+  if (total == 0){
+    iov_release(iov, iovcnt);
+    return 0;
+  }
+
+  for (i = 0; i < iovcnt; i++)
+    if (iov[i].iov_len > 0){
+      if (only == NULL)
+        only = &iov[i];
+      else{
+        only = NULL;
+        break;
+      }
+    }
+
+  if (!writing && file == NULL){
+    for (i = 0; iov[i].iov_len == 0; i++)
+      continue;
+    n = read(0, iov[i].iov_base, iov[i].iov_len);
+    iov_release(iov, iovcnt);
+    return n;
+  }
+
+  if (only != NULL){
+    buf = only->iov_base;
+    buf_size = total;
+  }
+  else{
+    buf_size = total < PGSIZE ? total : PGSIZE;
+    buf = malloc(buf_size);
+    if (buf == NULL){
+      iov_release(iov, iovcnt);
+      return -1;
+    }
+  }
+
+  for (done = 0; done < total; done += n){
+    size_t chunk = total - done < buf_size ? total - done : buf_size;
+
+    if (writing){
+      if (only == NULL)
+        iov_copy(iov, iovcnt, done, buf, chunk, false);
+      if (file == NULL){
+        putbuf((const char *) buf, chunk);
+        n = chunk;
+      }
+      else
+        n = file_write(file->file, buf, chunk);
+    }
+    else{
+      n = file_read(file->file, buf, chunk);
+      if (only == NULL)
+        iov_copy(iov, iovcnt, done, buf, n, true);
+    }
+    if ((size_t) n < chunk){
+      done += n;
+      break;
+    }
+  }
+
+  if (only == NULL)
+    free(buf);
+  iov_release(iov, iovcnt);
+  return done;
+}
+
+int readv(int fd, const struct iovec *iov, int iovcnt){
+  return iov_transfer(fd, iov, iovcnt, false);
+}
+
+int writev(int fd, const struct iovec *iov, int iovcnt){
+  return iov_transfer(fd, iov, iovcnt, true);
+}
+
+/* Returns true if a transfer of SIZE bytes at byte POSITION stays
+   within the range of off_t. */
+static bool valid_range(unsigned size, unsigned position){
+  return position <= INT_MAX && size <= INT_MAX - position;
+}
+
+/* Reads SIZE bytes from FD at byte POSITION into BUFFER, leaving
+   FD's file position alone. */
+int pread(int fd, void *buffer, unsigned size, unsigned position){
+  is_valid_arg(buffer);
+  struct file_descriptor *file = fd_to_fd(fd);
+  if (file == NULL || !valid_range(size, position))
+    return -1;
+
+  set_evict_file(buffer,size,true);
+  int result = file_read_at(file->file, buffer, size, position);
+  set_evict_file(buffer,size,false);
+  return result;
+}
+
+/* Writes SIZE bytes from BUFFER into FD at byte POSITION, leaving
+   FD's file position alone. */
+int pwrite(int fd, const void *buffer, unsigned size, unsigned position){
+  is_valid_arg((void *) buffer);
+  struct file_descriptor *file = fd_to_fd(fd);
+  if (file == NULL || file_is_dir(file->file) || !valid_range(size, position))
+    return -1;
+
+  set_evict_file((void *) buffer,size,true);
+  int result = file_write_at(file->file, buffer, size, position);
+  set_evict_file((void *) buffer,size,false);
+  return result;
+}
+
+/* Reads up to CNT entries of directory FD into ENTS, continuing
+   where the last readdir() or getdents() on FD left off.
+   Returns the number of entries read, 0 at the end of the
+   directory, or -1 if FD is not an open directory or memory
+   runs out. */
+int getdents(int fd, struct dirent *ents, unsigned cnt){
+  is_valid_arg(ents);
+  struct file_descriptor *file = fd_to_fd(fd);
+  if (file == NULL || file->dir == NULL)
+    return -1;
+  if (cnt > INT_MAX / sizeof *ents)
+    cnt = INT_MAX / sizeof *ents;
+  if (cnt == 0)
+    return 0;
+
+  unsigned size = cnt * sizeof *ents;
+  set_evict_file(ents,size,true);
+  int result = dir_getdents(file->dir, ents, cnt);
+  set_evict_file(ents,size,false);
+  return result;
+}
+
+/* Copies *ST out to user buffer UST. */
+static void put_stat(struct stat *ust, const struct stat *st){
+  set_evict_file(ust,sizeof *ust,true);
+  memcpy(ust, st, sizeof *ust);
+  set_evict_file(ust,sizeof *ust,false);
+}
+
+bool stat(const char *file, struct stat *st){
+  struct stat kst;
+
+  if (file == NULL)
+    exit(-1);
+  is_valid_arg((void *) file);
+  is_valid_arg(st);
+  if (!filesys_stat(file, &kst))
+    return false;
+  put_stat(st, &kst);
+  return true;
+}
+
+bool fstat(int fd, struct stat *st){
+  struct stat kst;
+
+  is_valid_arg(st);
+  struct file_descriptor *file = fd_to_fd(fd);
+  if (file == NULL)
+    return false;
+  /* A directory's descriptor holds a second reference, for
+     readdir(), but counts as one handle. */
+  inode_stat(file_get_inode(file->file), &kst, file->dir != NULL);
+  put_stat(st, &kst);
+  return true;
+}
+
+/* Grows FD to at least LENGTH bytes, allocating all of its disk
+   space at once. */
+bool fallocate(int fd, unsigned length){
+  struct file_descriptor *file = fd_to_fd(fd);
+  if (file == NULL || file_is_dir(file->file) || length > INT_MAX)
+    return false;
+  return file_allocate(file->file, length);
+}
 
 void set_evict_file(void *buffer, unsigned size, bool inevictable){
     unsigned bound = buffer + size;
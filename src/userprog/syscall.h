@@ -2,6 +2,9 @@
 #define USERPROG_SYSCALL_H
 #include <stdbool.h>
 #include <string.h>
+#include <dirent.h>
+#include <iovec.h>
+#include <stat.h>
 #include "../threads/thread.h"
 #include "../filesys/filesys.h"
 // #include "../filesys/file.c"
@@ -27,6 +30,7 @@ int write(int,const void*, unsigned);
 void seek(int,unsigned);
 unsigned tell(int);
 void close(int);
+void fd_table_destroy(void);
 void set_evict_file(void *, unsigned , bool);
 
 int mmap(int fd, void *addr);
@@ -37,4 +41,13 @@ bool mkdir(const char *);
 bool readdir(int, char *);
 bool isdir(int);
 int inumber(int);
+
+int readv(int, const struct iovec *, int);
+int writev(int, const struct iovec *, int);
+int pread(int, void *, unsigned, unsigned);
+int pwrite(int, const void *, unsigned, unsigned);
+int getdents(int, struct dirent *, unsigned);
+bool stat(const char *, struct stat *);
+bool fstat(int, struct stat *);
+bool fallocate(int, unsigned);
 #endif /* userprog/syscall.h */